@@ -0,0 +1,94 @@
+/*
+	Permission to use, copy, modify, and/or distribute this software for
+	any purpose with or without fee is hereby granted.
+
+	THE SOFTWARE IS PROVIDED “AS IS” AND THE AUTHOR DISCLAIMS ALL
+	WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+	FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+	DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+	AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <stdalign.h>
+#include <string.h>
+
+#include "h.h"
+
+#define align_up(x) (((x) + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1))
+
+static struct h_arena_chunk* create_chunk(size_t size)
+{
+	struct h_arena_chunk* chunk = malloc(sizeof(struct h_arena_chunk) + size);
+
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+
+	return chunk;
+}
+
+void* h_arena_alloc(struct h_arena* arena, size_t size)
+{
+	size = align_up(size);
+
+	struct h_arena_chunk* chunk = arena->chunks;
+
+	if (chunk == NULL || chunk->size - chunk->used < size) {
+		chunk       = create_chunk(size > H_ARENA_CHUNK_SIZE ? size : H_ARENA_CHUNK_SIZE);
+		chunk->next = arena->chunks;
+
+		arena->chunks = chunk;
+	}
+
+	void* ptr = chunk->data + chunk->used;
+	chunk->used += size;
+
+	return ptr;
+}
+
+void* h_arena_realloc(struct h_arena* arena, void* ptr, size_t old_size, size_t size)
+{
+	if (ptr == NULL)
+		return h_arena_alloc(arena, size);
+
+	struct h_arena_chunk* chunk = arena->chunks;
+
+	old_size = align_up(old_size);
+
+	if ((char*) ptr + old_size == chunk->data + chunk->used
+			&& chunk->size - chunk->used + old_size >= align_up(size)) {
+		chunk->used += align_up(size) - old_size;
+		return ptr;
+	}
+
+	void* new_ptr = h_arena_alloc(arena, size);
+	memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+
+	return new_ptr;
+}
+
+void h_arena_reset(struct h_arena* arena)
+{
+	if (arena->chunks == NULL)
+		return;
+
+	struct h_arena_chunk* chunk = arena->chunks->next;
+	while (chunk != NULL) {
+		struct h_arena_chunk* next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+
+	arena->chunks->next = NULL;
+	arena->chunks->used = 0;
+}
+
+void h_arena_free(struct h_arena* arena)
+{
+	h_arena_reset(arena);
+
+	free(arena->chunks);
+	arena->chunks = NULL;
+}
@@ -0,0 +1,498 @@
+/*
+	Permission to use, copy, modify, and/or distribute this software for
+	any purpose with or without fee is hereby granted.
+
+	THE SOFTWARE IS PROVIDED “AS IS” AND THE AUTHOR DISCLAIMS ALL
+	WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+	FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+	DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+	AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "h.h"
+
+static void* allocate(struct h_arena* arena, size_t size)
+{
+	return arena != NULL ? h_arena_alloc(arena, size) : malloc(size);
+}
+
+static size_t element_size(enum h_array_kind kind)
+{
+	switch (kind) {
+	case H_ARRAY_VALUES: return sizeof(struct h_value);
+	case H_ARRAY_INTEGERS: return sizeof(int64_t);
+	case H_ARRAY_REALS: return sizeof(double);
+	case H_ARRAY_COMPLEXES: return sizeof(double complex);
+	case H_ARRAY_BYTES: return sizeof(char);
+	case H_ARRAY_TREE: return sizeof(struct h_value);
+	case H_ARRAY_VIEW: return 0;
+	}
+
+	return 0;
+}
+
+static enum h_array_kind kind_of(const struct h_value* value)
+{
+	if (h_value_get_type(value) == H_CHAR)
+		return H_ARRAY_BYTES;
+
+	if (h_value_get_type(value) != H_NUMBER)
+		return H_ARRAY_VALUES;
+
+	switch (h_value_get_number_kind(value)) {
+	case H_NUMBER_INTEGER: return H_ARRAY_INTEGERS;
+	case H_NUMBER_REAL: return H_ARRAY_REALS;
+	case H_NUMBER_COMPLEX: return H_ARRAY_COMPLEXES;
+	case H_NUMBER_BIG: return H_ARRAY_VALUES;
+	}
+
+	return H_ARRAY_VALUES;
+}
+
+static bool fits(enum h_array_kind kind, enum h_array_kind element_kind)
+{
+	return kind == H_ARRAY_VALUES || kind == H_ARRAY_TREE || element_kind == kind
+		|| (kind == H_ARRAY_COMPLEXES && element_kind == H_ARRAY_REALS)
+		|| ((kind == H_ARRAY_REALS || kind == H_ARRAY_COMPLEXES) && element_kind == H_ARRAY_INTEGERS);
+}
+
+static enum h_array_kind join(enum h_array_kind kind, enum h_array_kind element_kind)
+{
+	if (fits(kind, element_kind))
+		return kind;
+
+	if (fits(element_kind, kind))
+		return element_kind;
+
+	return H_ARRAY_VALUES;
+}
+
+struct h_array* h_array_create(struct h_arena* arena)
+{
+	struct h_array* array = allocate(arena, sizeof(struct h_array));
+
+	*array = (struct h_array) {
+		.ref_count = 1,
+		.kind      = H_ARRAY_VALUES,
+		.arena     = arena,
+		.data      = { .values = { .arena = arena } },
+	};
+
+	return array;
+}
+
+struct h_array* h_array_create_packed(struct h_arena* arena, enum h_array_kind kind)
+{
+	struct h_array* array = h_array_create(arena);
+	array->kind = kind;
+
+	return array;
+}
+
+struct h_array* h_array_from_values(struct h_arena* arena, struct h_value_stack* values)
+{
+	struct h_array* array = h_array_create(arena);
+
+	enum h_array_kind kind = values->count == 0 ? H_ARRAY_VALUES : kind_of(&values->value[0]);
+	for (size_t i = 1; i < values->count && kind != H_ARRAY_VALUES; i++)
+		kind = join(kind, kind_of(&values->value[i]));
+
+	if (kind == H_ARRAY_VALUES) {
+		array->data.values            = *values;
+		array->data.values.root_stack = NULL;
+		array->data.values.arena      = arena;
+
+		return array;
+	}
+
+	array->kind = kind;
+	h_array_reserve(array, values->count);
+
+	for (size_t i = 0; i < values->count; i++)
+		h_array_push(array, values->value[i]);
+
+	values->count = 0;
+	h_value_stack_free(values);
+
+	return array;
+}
+
+struct h_array* h_array_from_bytes(struct h_arena* arena, const char* bytes, size_t count)
+{
+	struct h_array* array = h_array_create_packed(arena, H_ARRAY_BYTES);
+
+	h_base_stack_append_n(&array->data.base, bytes, count, sizeof(char));
+
+	return array;
+}
+
+struct h_array* h_array_create_view(struct h_arena* arena, struct h_array* base, size_t offset, size_t count,
+		size_t stride)
+{
+	struct h_array* array = h_array_create_packed(arena, H_ARRAY_VIEW);
+
+	if (base->kind == H_ARRAY_VIEW) {
+		offset  = base->data.view.offset + offset * base->data.view.stride;
+		stride *= base->data.view.stride;
+		base    = base->data.view.base;
+	}
+
+	__atomic_fetch_add(&base->ref_count, 1, __ATOMIC_RELAXED);
+
+	array->data.view = (struct h_array_view) {
+		.base   = base,
+		.offset = offset,
+		.count  = count,
+		.stride = stride,
+	};
+
+	return array;
+}
+
+static void release_view(struct h_array* array)
+{
+	struct h_value base = h_make_array(array->data.view.base);
+
+	h_value_release(&base);
+}
+
+void h_array_free(struct h_array* array)
+{
+	if (array->kind == H_ARRAY_VIEW)
+		release_view(array);
+	else if (array->kind == H_ARRAY_TREE)
+		h_tree_release(array->data.tree);
+	else if (array->kind == H_ARRAY_VALUES)
+		h_value_stack_free(&array->data.values);
+	else if (array->arena == NULL)
+		free(array->data.base.ptr);
+
+	if (array->arena == NULL)
+		free(array);
+}
+
+static void materialize(struct h_array* array);
+
+static void push_raw(struct h_array* array, struct h_value value)
+{
+	materialize(array);
+
+	switch (array->kind) {
+	case H_ARRAY_VALUES:
+		h_value_stack_push(&array->data.values, &value);
+		break;
+
+	case H_ARRAY_INTEGERS: {
+		int64_t integer = h_value_get_integer(&value);
+		h_base_stack_push(&array->data.base, &integer, sizeof(integer));
+		break;
+	}
+
+	case H_ARRAY_REALS: {
+		double real = creal(h_value_get_number(&value));
+		h_base_stack_push(&array->data.base, &real, sizeof(real));
+		break;
+	}
+
+	case H_ARRAY_COMPLEXES: {
+		double complex number = h_value_get_number(&value);
+		h_base_stack_push(&array->data.base, &number, sizeof(number));
+		break;
+	}
+
+	case H_ARRAY_BYTES: {
+		char charester = h_value_get_char(&value);
+		h_base_stack_push(&array->data.base, &charester, sizeof(charester));
+		break;
+	}
+
+	case H_ARRAY_TREE:
+		array->data.tree = h_tree_push(array->arena, array->data.tree, value);
+		break;
+
+	case H_ARRAY_VIEW:
+		/* materialized above */
+		break;
+	}
+}
+
+static void change_kind(struct h_array* array, enum h_array_kind kind)
+{
+	if (array->kind == kind)
+		return;
+
+	struct h_array changed = {
+		.kind  = kind,
+		.arena = array->arena,
+		.data  = { .base = { .arena = array->arena } },
+	};
+
+	h_array_reserve(&changed, h_array_count(array));
+
+	for (size_t i = 0; i < h_array_count(array); i++)
+		push_raw(&changed, h_array_get(array, i));
+
+	if (array->kind == H_ARRAY_TREE)
+		h_tree_release(array->data.tree);
+	else if (array->arena == NULL)
+		free(array->data.base.ptr);
+
+	array->kind = kind;
+	array->data = changed.data;
+}
+
+static void materialize(struct h_array* array)
+{
+	if (array->kind != H_ARRAY_VIEW)
+		return;
+
+	struct h_array changed = {
+		.kind  = array->data.view.base->kind,
+		.arena = array->arena,
+		.data  = { .base = { .arena = array->arena } },
+	};
+
+	h_array_reserve(&changed, h_array_count(array));
+
+	for (size_t i = 0; i < h_array_count(array); i++) {
+		struct h_value value = h_array_get(array, i);
+		h_value_retain(&value);
+
+		push_raw(&changed, value);
+	}
+
+	release_view(array);
+
+	array->kind = changed.kind;
+	array->data = changed.data;
+}
+
+static void fit(struct h_array* array, enum h_array_kind element_kind)
+{
+	if (h_array_count(array) == 0)
+		change_kind(array, element_kind);
+	else
+		change_kind(array, join(array->kind, element_kind));
+}
+
+size_t h_array_count(const struct h_array* array)
+{
+	if (array->kind == H_ARRAY_TREE)
+		return h_tree_count(array->data.tree);
+
+	if (array->kind == H_ARRAY_VIEW)
+		return array->data.view.count;
+
+	return array->data.base.count;
+}
+
+struct h_value h_array_get(const struct h_array* array, size_t index)
+{
+	switch (array->kind) {
+	case H_ARRAY_VALUES: return array->data.values.value[index];
+	case H_ARRAY_INTEGERS: return h_make_integer(array->data.integers.integers[index]);
+	case H_ARRAY_REALS: return h_make_real(array->data.reals.reals[index]);
+	case H_ARRAY_COMPLEXES: return h_make_number(array->data.complexes.complexes[index]);
+	case H_ARRAY_BYTES: return h_make_char(array->data.bytes.bytes[index]);
+	case H_ARRAY_TREE: return h_tree_get(array->data.tree, index);
+	case H_ARRAY_VIEW:
+		return h_array_get(array->data.view.base, array->data.view.offset + index * array->data.view.stride);
+	}
+
+	return h_make_number(0);
+}
+
+void h_array_set(struct h_array* array, size_t index, struct h_value value)
+{
+	materialize(array);
+	change_kind(array, join(array->kind, kind_of(&value)));
+
+	switch (array->kind) {
+	case H_ARRAY_VALUES:
+		h_value_release(&array->data.values.value[index]);
+		array->data.values.value[index] = value;
+		break;
+
+	case H_ARRAY_INTEGERS:
+		array->data.integers.integers[index] = h_value_get_integer(&value);
+		break;
+
+	case H_ARRAY_REALS:
+		array->data.reals.reals[index] = creal(h_value_get_number(&value));
+		break;
+
+	case H_ARRAY_COMPLEXES:
+		array->data.complexes.complexes[index] = h_value_get_number(&value);
+		break;
+
+	case H_ARRAY_BYTES:
+		array->data.bytes.bytes[index] = h_value_get_char(&value);
+		break;
+
+	case H_ARRAY_TREE:
+		array->data.tree = h_tree_set(array->arena, array->data.tree, index, value);
+		break;
+
+	case H_ARRAY_VIEW:
+		/* materialized above */
+		break;
+	}
+}
+
+void h_array_reserve(struct h_array* array, size_t count)
+{
+	materialize(array);
+
+	if (array->kind == H_ARRAY_TREE)
+		return;
+
+	h_base_stack_reserve(&array->data.base, count, element_size(array->kind));
+}
+
+void h_array_push(struct h_array* array, struct h_value value)
+{
+	materialize(array);
+	fit(array, kind_of(&value));
+	push_raw(array, value);
+}
+
+struct h_value h_array_pop(struct h_array* array)
+{
+	if (array->kind == H_ARRAY_TREE) {
+		struct h_value value;
+		array->data.tree = h_tree_pop(array->arena, array->data.tree, &value);
+
+		return value;
+	}
+
+	if (array->kind == H_ARRAY_VIEW) {
+		struct h_value value = h_array_get(array, --array->data.view.count);
+		h_value_retain(&value);
+
+		return value;
+	}
+
+	struct h_value value = h_array_get(array, array->data.base.count - 1);
+
+	h_base_stack_drop(&array->data.base, element_size(array->kind));
+
+	return value;
+}
+
+void h_array_append(struct h_array* array, const struct h_array* tail)
+{
+	size_t count = h_array_count(tail);
+
+	if (count == 0)
+		return;
+
+	materialize(array);
+
+#ifdef H_PERSISTENT_ARRAYS
+	if (h_array_count(array) + count >= H_ARRAY_TREE_THRESHOLD)
+		change_kind(array, H_ARRAY_TREE);
+#endif
+
+	enum h_array_kind tail_kind;
+	size_t stride;
+	const void* data = h_array_data(tail, &tail_kind, &stride);
+
+	fit(array, tail_kind);
+
+	if (array->kind == H_ARRAY_TREE && tail->kind == H_ARRAY_TREE) {
+		h_tree_retain(tail->data.tree);
+		array->data.tree = h_tree_cat(array->arena, array->data.tree, tail->data.tree);
+
+		return;
+	}
+
+	if (data != NULL && stride == 1 && array->kind == tail_kind) {
+		h_base_stack_append_n(&array->data.base, data, count, element_size(tail_kind));
+
+		if (array->kind == H_ARRAY_VALUES)
+			for (size_t i = h_array_count(array) - count; i < h_array_count(array); i++)
+				h_value_retain(&array->data.values.value[i]);
+
+		return;
+	}
+
+	h_array_reserve(array, count);
+
+	for (size_t i = 0; i < count; i++) {
+		struct h_value value = h_array_get(tail, i);
+		h_value_retain(&value);
+
+		push_raw(array, value);
+	}
+}
+
+struct h_array* h_array_mutable(struct h_value* value)
+{
+	struct h_array* array = h_value_get_array(value);
+
+	if (__atomic_load_n(&array->ref_count, __ATOMIC_ACQUIRE) == 1)
+		return array;
+
+	struct h_array* copy;
+
+	if (array->kind == H_ARRAY_VIEW) {
+		copy = h_array_create_view(array->arena, array->data.view.base, array->data.view.offset,
+				array->data.view.count, array->data.view.stride);
+	} else if (array->kind == H_ARRAY_TREE) {
+		copy            = h_array_create_packed(array->arena, H_ARRAY_TREE);
+		copy->data.tree = array->data.tree;
+
+		h_tree_retain(copy->data.tree);
+	} else {
+		copy = h_array_create(array->arena);
+
+		h_array_append(copy, array);
+	}
+
+	h_value_release(value);
+	*value = h_make_array(copy);
+
+	return copy;
+}
+
+const void* h_array_data(const struct h_array* array, enum h_array_kind* kind, size_t* stride)
+{
+	const struct h_array* base = array->kind == H_ARRAY_VIEW ? array->data.view.base : array;
+
+	*kind   = base->kind;
+	*stride = array->kind == H_ARRAY_VIEW ? array->data.view.stride : 1;
+
+	if (base->kind == H_ARRAY_TREE)
+		return NULL;
+
+	if (array->kind == H_ARRAY_VIEW)
+		return (const char*) base->data.base.ptr + array->data.view.offset * element_size(base->kind);
+
+	return base->data.base.ptr;
+}
+
+bool h_array_is_string(const struct h_array* array)
+{
+	if (array->kind == H_ARRAY_VALUES)
+		return h_is_array_string(&array->data.values);
+
+	if (array->kind == H_ARRAY_VIEW && array->data.view.base->kind == H_ARRAY_BYTES)
+		return true;
+
+	if (array->kind == H_ARRAY_TREE || array->kind == H_ARRAY_VIEW) {
+		for (size_t i = 0; i < h_array_count(array); i++) {
+			struct h_value value = h_array_get(array, i);
+
+			if (h_value_get_type(&value) != H_CHAR)
+				return false;
+		}
+
+		return true;
+	}
+
+	return array->kind == H_ARRAY_BYTES || h_array_count(array) == 0;
+}
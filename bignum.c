@@ -0,0 +1,446 @@
+/*
+	Permission to use, copy, modify, and/or distribute this software for
+	any purpose with or without fee is hereby granted.
+
+	THE SOFTWARE IS PROVIDED “AS IS” AND THE AUTHOR DISCLAIMS ALL
+	WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+	FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+	DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+	AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "h.h"
+
+#define BINARY_BASE ((uint64_t) 1 << 32)
+#define DECIMAL_BASE 1000000000
+#define DECIMAL_DIGITS 9
+
+#define KARATSUBA_THRESHOLD 32
+#define CONVERSION_THRESHOLD 32
+#define MAX_CONVERSION_POWERS 64
+
+struct limbs {
+	uint32_t* limbs;
+	size_t count;
+};
+
+static struct h_bignum* create(size_t count)
+{
+	struct h_bignum* bignum = malloc(sizeof(struct h_bignum) + count * sizeof(uint32_t));
+
+	bignum->ref_count = 1;
+	bignum->negative  = false;
+	bignum->count     = count;
+
+	memset(bignum->limbs, 0, count * sizeof(uint32_t));
+
+	return bignum;
+}
+
+static size_t trim(const uint32_t* limbs, size_t count)
+{
+	while (count > 0 && limbs[count - 1] == 0)
+		count--;
+
+	return count;
+}
+
+static struct h_bignum* normalize(struct h_bignum* bignum)
+{
+	bignum->count = trim(bignum->limbs, bignum->count);
+
+	if (bignum->count == 0)
+		bignum->negative = false;
+
+	return bignum;
+}
+
+static uint64_t split(uint64_t value, uint64_t base, uint32_t* limb)
+{
+	if (base == BINARY_BASE) {
+		*limb = (uint32_t) value;
+		return value >> 32;
+	}
+
+	*limb = value % DECIMAL_BASE;
+
+	return value / DECIMAL_BASE;
+}
+
+static uint32_t add_to(uint32_t* result, size_t result_count, const uint32_t* limbs, size_t count,
+		uint64_t base)
+{
+	uint64_t carry = 0;
+
+	for (size_t i = 0; i < result_count && (i < count || carry != 0); i++) {
+		uint64_t sum = (uint64_t) result[i] + (i < count ? limbs[i] : 0) + carry;
+
+		carry     = sum >= base;
+		result[i] = carry ? sum - base : sum;
+	}
+
+	return carry;
+}
+
+static void sub_from(uint32_t* result, size_t result_count, const uint32_t* limbs, size_t count,
+		uint64_t base)
+{
+	uint64_t borrow = 0;
+
+	for (size_t i = 0; i < result_count && (i < count || borrow != 0); i++) {
+		uint64_t sub = (i < count ? limbs[i] : 0) + borrow;
+
+		borrow    = result[i] < sub;
+		result[i] = borrow ? result[i] + base - sub : result[i] - sub;
+	}
+}
+
+static void multiply_basecase(uint32_t* result, const uint32_t* a, size_t a_count, const uint32_t* b,
+		size_t b_count, uint64_t base)
+{
+	memset(result, 0, (a_count + b_count) * sizeof(uint32_t));
+
+	for (size_t i = 0; i < a_count; i++) {
+		uint64_t carry = 0;
+
+		if (a[i] == 0)
+			continue;
+
+		for (size_t j = 0; j < b_count; j++)
+			carry = split((uint64_t) a[i] * b[j] + result[i + j] + carry, base, &result[i + j]);
+
+		result[i + b_count] = carry;
+	}
+}
+
+static void multiply(uint32_t* result, const uint32_t* a, size_t a_count, const uint32_t* b, size_t b_count,
+		uint64_t base)
+{
+	if (a_count < b_count) {
+		const uint32_t* limbs = a;
+		size_t count          = a_count;
+
+		a       = b;
+		a_count = b_count;
+		b       = limbs;
+		b_count = count;
+	}
+
+	if (b_count < KARATSUBA_THRESHOLD) {
+		multiply_basecase(result, a, a_count, b, b_count, base);
+		return;
+	}
+
+	size_t half         = (a_count + 1) / 2;
+	size_t result_count = a_count + b_count;
+
+	if (b_count <= half) {
+		uint32_t* high = malloc((a_count - half + b_count) * sizeof(uint32_t));
+
+		multiply(result, a, half, b, b_count, base);
+		memset(result + half + b_count, 0, (result_count - half - b_count) * sizeof(uint32_t));
+
+		multiply(high, a + half, a_count - half, b, b_count, base);
+		add_to(result + half, result_count - half, high, a_count - half + b_count, base);
+
+		free(high);
+
+		return;
+	}
+
+	uint32_t* a_sum  = calloc(half + 1, sizeof(uint32_t));
+	uint32_t* b_sum  = calloc(half + 1, sizeof(uint32_t));
+	uint32_t* middle = malloc((2 * half + 2) * sizeof(uint32_t));
+
+	multiply(result, a, half, b, half, base);
+	multiply(result + 2 * half, a + half, a_count - half, b + half, b_count - half, base);
+
+	memcpy(a_sum, a, half * sizeof(uint32_t));
+	memcpy(b_sum, b, half * sizeof(uint32_t));
+	add_to(a_sum, half + 1, a + half, a_count - half, base);
+	add_to(b_sum, half + 1, b + half, b_count - half, base);
+
+	multiply(middle, a_sum, half + 1, b_sum, half + 1, base);
+	sub_from(middle, 2 * half + 2, result, 2 * half, base);
+	sub_from(middle, 2 * half + 2, result + 2 * half, result_count - 2 * half, base);
+
+	add_to(result + half, result_count - half, middle, trim(middle, 2 * half + 2), base);
+
+	free(a_sum);
+	free(b_sum);
+	free(middle);
+}
+
+void h_bignum_retain(struct h_bignum* bignum)
+{
+	__atomic_fetch_add(&bignum->ref_count, 1, __ATOMIC_RELAXED);
+}
+
+void h_bignum_release(struct h_bignum* bignum)
+{
+	if (__atomic_sub_fetch(&bignum->ref_count, 1, __ATOMIC_ACQ_REL) == 0)
+		free(bignum);
+}
+
+struct h_bignum* h_bignum_from_integer(int64_t integer)
+{
+	struct h_bignum* bignum = create(2);
+	uint64_t magnitude      = integer < 0 ? -(uint64_t) integer : (uint64_t) integer;
+
+	bignum->negative = integer < 0;
+	bignum->limbs[0] = (uint32_t) magnitude;
+	bignum->limbs[1] = magnitude >> 32;
+
+	return normalize(bignum);
+}
+
+struct h_bignum* h_bignum_from_limbs(bool negative, const uint32_t* limbs, size_t count)
+{
+	struct h_bignum* bignum = create(count);
+
+	memcpy(bignum->limbs, limbs, count * sizeof(uint32_t));
+	bignum->negative = negative;
+
+	return normalize(bignum);
+}
+
+bool h_bignum_to_integer(const struct h_bignum* bignum, int64_t* integer)
+{
+	if (bignum->count > 2)
+		return false;
+
+	uint64_t magnitude = 0;
+	for (size_t i = bignum->count; i > 0; i--)
+		magnitude = magnitude << 32 | bignum->limbs[i - 1];
+
+	if (magnitude > H_MAX_EXACT_INTEGER)
+		return false;
+
+	*integer = bignum->negative ? -(int64_t) magnitude : (int64_t) magnitude;
+
+	return true;
+}
+
+double h_bignum_to_double(const struct h_bignum* bignum)
+{
+	double result = 0;
+	size_t low    = bignum->count > 3 ? bignum->count - 3 : 0;
+
+	for (size_t i = bignum->count; i > low; i--)
+		result = result * BINARY_BASE + bignum->limbs[i - 1];
+
+	result = ldexp(result, 32 * low);
+
+	return bignum->negative ? -result : result;
+}
+
+static int compare_magnitude(const struct h_bignum* a, const struct h_bignum* b)
+{
+	if (a->count != b->count)
+		return a->count < b->count ? -1 : 1;
+
+	for (size_t i = a->count; i > 0; i--) {
+		if (a->limbs[i - 1] != b->limbs[i - 1])
+			return a->limbs[i - 1] < b->limbs[i - 1] ? -1 : 1;
+	}
+
+	return 0;
+}
+
+int h_bignum_compare(const struct h_bignum* a, const struct h_bignum* b)
+{
+	if (a->negative != b->negative)
+		return a->negative ? -1 : 1;
+
+	return a->negative ? compare_magnitude(b, a) : compare_magnitude(a, b);
+}
+
+static struct h_bignum* add(const struct h_bignum* a, bool a_negative, const struct h_bignum* b,
+		bool b_negative)
+{
+	if (compare_magnitude(a, b) < 0)
+		return add(b, b_negative, a, a_negative);
+
+	struct h_bignum* result = create(a->count + 1);
+
+	memcpy(result->limbs, a->limbs, a->count * sizeof(uint32_t));
+	result->negative = a_negative;
+
+	if (a_negative == b_negative)
+		add_to(result->limbs, result->count, b->limbs, b->count, BINARY_BASE);
+	else
+		sub_from(result->limbs, result->count, b->limbs, b->count, BINARY_BASE);
+
+	return normalize(result);
+}
+
+struct h_bignum* h_bignum_add(const struct h_bignum* a, const struct h_bignum* b)
+{
+	return add(a, a->negative, b, b->negative);
+}
+
+struct h_bignum* h_bignum_sub(const struct h_bignum* a, const struct h_bignum* b)
+{
+	return add(a, a->negative, b, !b->negative);
+}
+
+struct h_bignum* h_bignum_mul(const struct h_bignum* a, const struct h_bignum* b)
+{
+	struct h_bignum* result = create(a->count + b->count);
+
+	if (a->count != 0 && b->count != 0)
+		multiply(result->limbs, a->limbs, a->count, b->limbs, b->count, BINARY_BASE);
+
+	result->negative = a->negative != b->negative;
+
+	return normalize(result);
+}
+
+struct h_bignum* h_bignum_divide_small(const struct h_bignum* bignum, uint32_t divisor, uint32_t* remainder)
+{
+	struct h_bignum* result = create(bignum->count);
+	uint64_t rest           = 0;
+
+	for (size_t i = bignum->count; i > 0; i--) {
+		uint64_t value = rest << 32 | bignum->limbs[i - 1];
+
+		result->limbs[i - 1] = value / divisor;
+		rest                 = value % divisor;
+	}
+
+	*remainder       = rest;
+	result->negative = bignum->negative;
+
+	return normalize(result);
+}
+
+static struct limbs to_decimal_basecase(const uint32_t* limbs, size_t count)
+{
+	uint32_t* rest = malloc(count * sizeof(uint32_t) + 1);
+	struct limbs decimal = {
+		.limbs = malloc((count * 32 / 29 + 2) * sizeof(uint32_t)),
+	};
+
+	memcpy(rest, limbs, count * sizeof(uint32_t));
+
+	while ((count = trim(rest, count)) > 0) {
+		uint64_t remainder = 0;
+
+		for (size_t i = count; i > 0; i--) {
+			uint64_t value = remainder << 32 | rest[i - 1];
+
+			rest[i - 1] = value / DECIMAL_BASE;
+			remainder   = value % DECIMAL_BASE;
+		}
+
+		decimal.limbs[decimal.count++] = remainder;
+	}
+
+	free(rest);
+
+	return decimal;
+}
+
+static struct limbs to_decimal(const uint32_t* limbs, size_t count, struct limbs* powers, size_t level)
+{
+	count = trim(limbs, count);
+
+	if (count <= CONVERSION_THRESHOLD)
+		return to_decimal_basecase(limbs, count);
+
+	size_t split_count = CONVERSION_THRESHOLD;
+	size_t split_level = 0;
+
+	while (split_count * 2 < count) {
+		split_count *= 2;
+		split_level++;
+	}
+
+	for (size_t i = level; i <= split_level; i++) {
+		if (powers[i].limbs != NULL)
+			continue;
+
+		if (i == 0) {
+			uint32_t power[CONVERSION_THRESHOLD + 1] = {0};
+			power[CONVERSION_THRESHOLD] = 1;
+
+			powers[i] = to_decimal_basecase(power, CONVERSION_THRESHOLD + 1);
+
+			continue;
+		}
+
+		powers[i].limbs = malloc(2 * powers[i - 1].count * sizeof(uint32_t));
+		multiply(powers[i].limbs, powers[i - 1].limbs, powers[i - 1].count, powers[i - 1].limbs,
+				powers[i - 1].count, DECIMAL_BASE);
+		powers[i].count = trim(powers[i].limbs, 2 * powers[i - 1].count);
+	}
+
+	struct limbs low  = to_decimal(limbs, split_count, powers, 0);
+	struct limbs high = to_decimal(limbs + split_count, count - split_count, powers, 0);
+
+	struct limbs result = {
+		.count = high.count + powers[split_level].count + 1,
+	};
+
+	result.limbs = calloc(result.count, sizeof(uint32_t));
+
+	if (high.count != 0)
+		multiply(result.limbs, high.limbs, high.count, powers[split_level].limbs, powers[split_level].count,
+				DECIMAL_BASE);
+
+	add_to(result.limbs, result.count, low.limbs, low.count, DECIMAL_BASE);
+	result.count = trim(result.limbs, result.count);
+
+	free(low.limbs);
+	free(high.limbs);
+
+	return result;
+}
+
+size_t h_bignum_to_string(const struct h_bignum* bignum, char* buf, size_t buf_size)
+{
+	struct limbs powers[MAX_CONVERSION_POWERS] = {0};
+	struct limbs decimal = to_decimal(bignum->limbs, bignum->count, powers, 0);
+
+	char digits[DECIMAL_DIGITS + 2];
+	size_t lenght = 0;
+
+	for (size_t i = decimal.count + 1; i > 0; i--) {
+		int digits_lenght;
+
+		if (i == decimal.count + 1)
+			digits_lenght = snprintf(digits, sizeof(digits), "%s", bignum->negative ? "-" : "");
+		else if (i == decimal.count)
+			digits_lenght = snprintf(digits, sizeof(digits), "%u", decimal.limbs[i - 1]);
+		else
+			digits_lenght = snprintf(digits, sizeof(digits), "%09u", decimal.limbs[i - 1]);
+
+		if (lenght + digits_lenght < buf_size)
+			memcpy(buf + lenght, digits, digits_lenght);
+		else if (lenght < buf_size)
+			memcpy(buf + lenght, digits, buf_size - lenght - 1);
+
+		lenght += digits_lenght;
+	}
+
+	if (decimal.count == 0 && lenght + 1 < buf_size)
+		buf[lenght] = '0';
+
+	if (decimal.count == 0)
+		lenght++;
+
+	if (buf_size > 0)
+		buf[lenght < buf_size ? lenght : buf_size - 1] = '\0';
+
+	for (size_t i = 0; i < MAX_CONVERSION_POWERS; i++)
+		free(powers[i].limbs);
+
+	free(decimal.limbs);
+
+	return lenght;
+}
@@ -14,6 +14,7 @@
 #include <complex.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "h.h"
 
@@ -24,9 +25,12 @@
 
 static const char header[] = { 'H', 'B' };
 
-static struct h_error read_instr_stack(FILE* file, struct h_instr_stack* stack);
+static struct h_error read_constants(FILE* file, struct h_program* program);
+static struct h_error read_symbols(FILE* file, struct h_program* program);
+static struct h_error read_code(FILE* file, struct h_program* program);
+static struct h_error read_lines(FILE* file, struct h_program* program);
 
-struct h_error h_read_bytecode(FILE* file, struct h_instr_stack* stack)
+struct h_error h_read_bytecode(FILE* file, struct h_program* program)
 {
 	char read_header[2];
 	if (fread(read_header, sizeof(read_header[0]), array_lenght(read_header), file)
@@ -42,176 +46,392 @@ struct h_error h_read_bytecode(FILE* file, struct h_instr_stack* stack)
 			.source = { .source_type = H_ERROR_BYTECODE_FILE },
 		};
 
-	continue_or_return_if_error(read_instr_stack(file, stack));
+	continue_or_return_if_error(read_constants(file, program));
+	continue_or_return_if_error(read_symbols(file, program));
+	continue_or_return_if_error(read_code(file, program));
+	continue_or_return_if_error(read_lines(file, program));
+
+	h_program_link(program);
+	h_verify_program(program);
 
 	return_ok();
 }
 
-static void write_instr_stack(FILE* file, const struct h_instr_stack* stack);
+static void write_value(FILE* file, const struct h_value* value);
 
-void h_write_bytecode(FILE* file, const struct h_instr_stack* stack)
+void h_write_bytecode(FILE* file, const struct h_program* program)
 {
 	fwrite(header, sizeof(header[0]), array_lenght(header), file);
 
-	write_instr_stack(file, stack);
-}
+	fwrite(&program->constants.count, sizeof(program->constants.count), 1, file);
 
-static void write_instr(FILE* file, const struct h_instr* instr);
+	for (size_t i = 0; i < program->constants.count; i++)
+		write_value(file, &program->constants.value[i]);
 
-static void write_instr_stack(FILE* file, const struct h_instr_stack* stack)
-{
-	fwrite(&stack->count, sizeof(stack->count), 1, file);
+	fwrite(&program->symbols.count, sizeof(program->symbols.count), 1, file);
 
-	for (int i = 0; i < stack->count; i++)
-		write_instr(file, &stack->instrs[i]);
-}
+	for (size_t i = 0; i < program->symbols.count; i++) {
+		size_t lenght = strlen(program->symbols.names[i]);
 
-static void write_value(FILE* file, const struct h_value* value);
+		fwrite(&lenght, sizeof(lenght), 1, file);
+		fwrite(program->symbols.names[i], sizeof(char), lenght, file);
+	}
 
-static void write_instr(FILE* file, const struct h_instr* instr)
-{
-	fwrite(&instr->type, sizeof(instr->type), 1, file);
+	fwrite(&program->code.count, sizeof(program->code.count), 1, file);
 
-	switch (instr->type) {
-	case H_ARRAY_DEF:
-		write_instr_stack(file, &instr->value.array_def);
+	for (size_t i = 0; i < program->code.count; i++) {
+		struct h_op op = program->code.ops[i];
 
-		break;
+		op.type  = h_op_generic(h_op_type(&op));
+		op.flags = h_op_flags(&op) & ~H_OP_DEOPTIMIZED;
 
-	case H_VALUE:
-		write_value(file, &instr->value.value);
+		fwrite(&op, sizeof(op), 1, file);
+	}
+
+	fwrite(&program->lines.count, sizeof(program->lines.count), 1, file);
+	fwrite(program->lines.lines, sizeof(struct h_line), program->lines.count, file);
+}
+
+static void write_number(FILE* file, const struct h_value* value)
+{
+	enum h_number_kind kind = h_value_get_number_kind(value);
+	const struct h_bignum* bignum;
+	double complex number;
+	int64_t integer;
+
+	fwrite(&kind, sizeof(kind), 1, file);
+
+	switch (kind) {
+	case H_NUMBER_INTEGER:
+		integer = h_value_get_integer(value);
+		fwrite(&integer, sizeof(integer), 1, file);
 
 		break;
 
-	case H_CALL_SUMBOIL:
-	case H_CREATE_VARIABLE:
-		fwrite(instr->value.sumboil, sizeof(instr->value.sumboil), 1, file);
+	case H_NUMBER_BIG:
+		bignum = h_value_get_bignum(value);
+
+		fwrite(&bignum->negative, sizeof(bignum->negative), 1, file);
+		fwrite(&bignum->count, sizeof(bignum->count), 1, file);
+		fwrite(bignum->limbs, sizeof(uint32_t), bignum->count, file);
 
 		break;
 
 	default:
+		number = h_value_get_number(value);
+		fwrite(&number, sizeof(number), 1, file);
+
 		break;
 	}
 }
 
 static void write_value(FILE* file, const struct h_value* value)
 {
-	fwrite(&value->type, sizeof(value->type), 1, file);
+	enum h_value_type type = h_value_get_type(value);
+	char charester;
+	const struct h_array* array;
+	size_t count;
+	struct h_value element;
 
-	switch (value->type) {
+	fwrite(&type, sizeof(type), 1, file);
+
+	switch (type) {
 	case H_NUMBER:
-		fwrite(&value->value.number, sizeof(value->value.number), 1, file);
+		write_number(file, value);
 
 		break;
 
 	case H_CHAR:
-		fwrite(&value->value.charester, sizeof(value->value.charester), 1, file);
+		charester = h_value_get_char(value);
+		fwrite(&charester, sizeof(charester), 1, file);
 
 		break;
 
 	case H_FUNCTION:
-		write_instr_stack(file, &value->value.function);
-
 		break;
 
 	case H_ARRAY:
+		array = h_value_get_array(value);
+		count = h_array_count(array);
+
+		fwrite(&count, sizeof(count), 1, file);
+
+		for (size_t i = 0; i < count; i++) {
+			element = h_array_get(array, i);
+			write_value(file, &element);
+		}
+
 		break;
 	}
 }
 
-static struct h_error read_instr(FILE* file, struct h_instr* instr);
+static struct h_error read_value(FILE* file, struct h_value* value, struct h_arena* arena);
 
-static struct h_error read_instr_stack(FILE* file, struct h_instr_stack* stack)
+static struct h_error read_constants(FILE* file, struct h_program* program)
 {
-	size_t stack_count;
-	if (fread(&stack_count, sizeof(stack_count), 1, file) != 1)
+	size_t count;
+	if (fread(&count, sizeof(count), 1, file) != 1)
 		return (struct h_error) {
 			.type   = H_ERROR_BYTECODE_READ_ERROR,
 			.source = { .source_type = H_ERROR_BYTECODE_FILE },
 		};
 
-	for (int i = 0; i < stack_count; i++) {
-		struct h_instr instr = {0};
-		continue_or_return_if_error(read_instr(file, &instr));	
+	for (size_t i = 0; i < count; i++) {
+		struct h_value value;
+		continue_or_return_if_error(read_value(file, &value, program->arena));
 
-		h_instr_stack_push(stack, &instr);
+		h_value_stack_push(&program->constants, &value);
 	}
 
 	return_ok();
 }
 
-static struct h_error read_value(FILE* file, struct h_value* value);
-
-static struct h_error read_instr(FILE* file, struct h_instr* instr)
+static struct h_error read_symbols(FILE* file, struct h_program* program)
 {
-	if (fread(&instr->type, sizeof(instr->type), 1, file) != 1)
+	size_t count;
+	if (fread(&count, sizeof(count), 1, file) != 1)
 		return (struct h_error) {
 			.type   = H_ERROR_BYTECODE_READ_ERROR,
 			.source = { .source_type = H_ERROR_BYTECODE_FILE },
 		};
 
-	switch (instr->type) {
-	case H_ARRAY_DEF:
-		continue_or_return_if_error(read_instr_stack(file, &instr->value.array_def));
+	for (size_t i = 0; i < count; i++) {
+		char name[H_MAX_SUMBOIL_NAME];
+		size_t lenght;
 
-		break;
+		if (fread(&lenght, sizeof(lenght), 1, file) != 1 || lenght >= sizeof(name)
+				|| fread(name, sizeof(char), lenght, file) != lenght)
+			return (struct h_error) {
+				.type   = H_ERROR_BYTECODE_READ_ERROR,
+				.source = { .source_type = H_ERROR_BYTECODE_FILE },
+			};
 
-	case H_VALUE:
-		continue_or_return_if_error(read_value(file, &instr->value.value));
+		name[lenght] = '\0';
 
-		break;
+		h_symbol_stack_push(&program->symbols, name);
+	}
+
+	return_ok();
+}
+
+static bool is_valid_op(const struct h_program* program, const struct h_op* op, size_t index, size_t end)
+{
+	switch (op->type) {
+	case H_CONST:
+		return op->operand < program->constants.count;
+
+	case H_ARRAY_DEF:
+	case H_FUNCTION_DEF:
+		return index + 1 + op->operand <= end;
 
 	case H_CALL_SUMBOIL:
 	case H_CREATE_VARIABLE:
-		if (fread(instr->value.sumboil, sizeof(instr->value.sumboil), 1, file) != 1)
+		return op->operand < program->symbols.count;
+
+	case H_NUMBER_OP:
+		return op->operand > H_VALUE && op->operand < H_INSTR_TYPE_COUNT && op->operand != H_NUMBER_OP
+			&& h_op_operands(op->operand) == 0 && h_fusions[op->operand].first == H_VALUE
+			&& op->operand != H_ARRAY_DEF && op->operand != H_FUNCTION_DEF;
+
+	default:
+		if ((unsigned) op->type >= H_INSTR_TYPE_COUNT || h_fusions[op->type].first == H_VALUE)
+			return op->type > H_VALUE && op->type <= H_CALL_SUMBOIL;
+
+		return is_valid_op(program, &(struct h_op) { h_fusions[op->type].first, op->operand }, index, end)
+			&& is_valid_op(program, &(struct h_op) { h_fusions[op->type].second, op->operand
+					+ h_op_operands(h_fusions[op->type].first) }, index, end);
+	}
+}
+
+static struct h_error read_code(FILE* file, struct h_program* program)
+{
+	size_t count;
+	if (fread(&count, sizeof(count), 1, file) != 1 || count > SIZE_MAX / sizeof(struct h_op))
+		return (struct h_error) {
+			.type   = H_ERROR_BYTECODE_READ_ERROR,
+			.source = { .source_type = H_ERROR_BYTECODE_FILE },
+		};
+
+	struct h_base_stack ends = {0};
+	h_base_stack_push(&ends, &count, sizeof(count));
+
+	for (size_t i = 0; i < count; i++) {
+		struct h_op op;
+
+		if (fread(&op, sizeof(op), 1, file) != 1) {
+			free(ends.ptr);
+
 			return (struct h_error) {
 				.type   = H_ERROR_BYTECODE_READ_ERROR,
 				.source = { .source_type = H_ERROR_BYTECODE_FILE },
 			};
+		}
+
+		while (*(size_t*) h_base_stack_peek(&ends, sizeof(size_t)) <= i)
+			h_base_stack_drop(&ends, sizeof(size_t));
+
+		if (!is_valid_op(program, &op, i, *(size_t*) h_base_stack_peek(&ends, sizeof(size_t)))) {
+			free(ends.ptr);
+
+			return (struct h_error) {
+				.type   = H_ERROR_BYTECODE_READ_ERROR,
+				.source = { .source_type = H_ERROR_BYTECODE_FILE },
+			};
+		}
+
+		if (op.type == H_ARRAY_DEF || op.type == H_FUNCTION_DEF) {
+			size_t body_end = i + 1 + op.operand;
+			h_base_stack_push(&ends, &body_end, sizeof(body_end));
+		}
+
+		h_op_stack_push(&program->code, &op);
+	}
+
+	free(ends.ptr);
+
+	return_ok();
+}
+
+static struct h_error read_lines(FILE* file, struct h_program* program)
+{
+	size_t count;
+	if (fread(&count, sizeof(count), 1, file) != 1)
+		return (struct h_error) {
+			.type   = H_ERROR_BYTECODE_READ_ERROR,
+			.source = { .source_type = H_ERROR_BYTECODE_FILE },
+		};
+
+	for (size_t i = 0; i < count; i++) {
+		struct h_line line;
+
+		if (fread(&line, sizeof(line), 1, file) != 1 || line.offset >= program->code.count
+				|| (i != 0 && line.offset <= program->lines.lines[i - 1].offset))
+			return (struct h_error) {
+				.type   = H_ERROR_BYTECODE_READ_ERROR,
+				.source = { .source_type = H_ERROR_BYTECODE_FILE },
+			};
+
+		h_line_stack_push(&program->lines, &line);
+	}
+
+	return_ok();
+}
+
+static struct h_error read_number(FILE* file, struct h_value* value)
+{
+	enum h_number_kind kind;
+	double complex number;
+	int64_t integer;
+	bool negative;
+	size_t count;
+
+	if (fread(&kind, sizeof(kind), 1, file) != 1)
+		return (struct h_error) {
+			.type   = H_ERROR_BYTECODE_READ_ERROR,
+			.source = { .source_type = H_ERROR_BYTECODE_FILE },
+		};
+
+	switch (kind) {
+	case H_NUMBER_INTEGER:
+		if (fread(&integer, sizeof(integer), 1, file) != 1)
+			return (struct h_error) {
+				.type   = H_ERROR_BYTECODE_READ_ERROR,
+				.source = { .source_type = H_ERROR_BYTECODE_FILE },
+			};
+
+		*value = h_make_integer(integer);
+
+		break;
+
+	case H_NUMBER_BIG:
+		if (fread(&negative, sizeof(negative), 1, file) != 1 || fread(&count, sizeof(count), 1, file) != 1)
+			return (struct h_error) {
+				.type   = H_ERROR_BYTECODE_READ_ERROR,
+				.source = { .source_type = H_ERROR_BYTECODE_FILE },
+			};
+
+		uint32_t* limbs = malloc(count * sizeof(uint32_t));
+
+		if (fread(limbs, sizeof(uint32_t), count, file) != count) {
+			free(limbs);
+
+			return (struct h_error) {
+				.type   = H_ERROR_BYTECODE_READ_ERROR,
+				.source = { .source_type = H_ERROR_BYTECODE_FILE },
+			};
+		}
+
+		*value = h_make_bignum(h_bignum_from_limbs(negative, limbs, count));
+		free(limbs);
 
 		break;
 
 	default:
+		if (fread(&number, sizeof(number), 1, file) != 1)
+			return (struct h_error) {
+				.type   = H_ERROR_BYTECODE_READ_ERROR,
+				.source = { .source_type = H_ERROR_BYTECODE_FILE },
+			};
+
+		*value = h_make_number(number);
+
 		break;
 	}
 
 	return_ok();
 }
 
-static struct h_error read_value(FILE* file, struct h_value* value)
+static struct h_error read_value(FILE* file, struct h_value* value, struct h_arena* arena)
 {
-	if (fread(&value->type, sizeof(value->type), 1, file) != 1)
+	enum h_value_type type;
+	char charester;
+	size_t count;
+	struct h_value element;
+
+	if (fread(&type, sizeof(type), 1, file) != 1)
 		return (struct h_error) {
 			.type   = H_ERROR_BYTECODE_READ_ERROR,
 			.source = { .source_type = H_ERROR_BYTECODE_FILE },
 		};
 
-	switch (value->type) {
+	switch (type) {
 	case H_NUMBER:
-		if (fread(&value->value.number, sizeof(value->value.number), 1, file) != 1)
+		continue_or_return_if_error(read_number(file, value));
+
+		break;
+
+	case H_CHAR:
+		if (fread(&charester, sizeof(charester), 1, file) != 1)
 			return (struct h_error) {
 				.type   = H_ERROR_BYTECODE_READ_ERROR,
 				.source = { .source_type = H_ERROR_BYTECODE_FILE },
 			};
 
+		*value = h_make_char(charester);
+
 		break;
 
-	case H_CHAR:
-		if (fread(&value->value.charester, sizeof(value->value.charester), 1, file) != 1)
+	case H_ARRAY:
+		if (fread(&count, sizeof(count), 1, file) != 1)
 			return (struct h_error) {
 				.type   = H_ERROR_BYTECODE_READ_ERROR,
 				.source = { .source_type = H_ERROR_BYTECODE_FILE },
 			};
 
-		break;
+		*value = h_make_array(h_array_create(arena));
 
-	case H_FUNCTION:
-		continue_or_return_if_error(read_instr_stack(file, &value->value.function));
-		
-		break;
+		for (size_t i = 0; i < count; i++) {
+			continue_or_return_if_error(read_value(file, &element, arena));
+			h_array_push(h_value_get_array(value), element);
+		}
 
-	case H_ARRAY:
 		break;
+
+	default:
+		return (struct h_error) {
+			.type   = H_ERROR_BYTECODE_READ_ERROR,
+			.source = { .source_type = H_ERROR_BYTECODE_FILE },
+		};
 	}
 
 	return_ok();
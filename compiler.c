@@ -0,0 +1,626 @@
+/*
+	Permission to use, copy, modify, and/or distribute this software for
+	any purpose with or without fee is hereby granted.
+
+	THE SOFTWARE IS PROVIDED “AS IS” AND THE AUTHOR DISCLAIMS ALL
+	WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+	FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+	DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+	AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "h.h"
+
+/*
+	Superinstructions, ordered by how often their pair was executed over the
+	example corpus. To regenerate, build with PROFILE_OPS=1 (fuse() leaves
+	the code alone in such builds), run representative programs as
+
+		./h -s -i program.hl -a args 2>&1 >/dev/null | sed '1,/op pairs/d'
+
+	and sum the counts per pair. Each hot pair worth fusing gets an
+	H_<FIRST>_<SECOND> instruction in h.h and an entry here, and in vm.c a
+	name in op_names plus execute_fused (or a dedicated handler) in
+	executors, execute_instr and the threaded handlers table. Pairs whose
+	instructions both take operands are only fused when the operands are
+	adjacent.
+*/
+const struct h_fusion h_fusions[H_INSTR_TYPE_COUNT] = {
+	[H_CONST_CONST] = { H_CONST, H_CONST },
+	[H_COPY_MUL]    = { H_COPY,  H_MUL },
+	[H_CONST_RANGE] = { H_CONST, H_RANGE },
+	[H_CONST_POW]   = { H_CONST, H_POW },
+	[H_CONST_ADD]   = { H_CONST, H_ADD },
+	[H_CONST_SUB]   = { H_CONST, H_SUB },
+	[H_CONST_MUL]   = { H_CONST, H_MUL },
+	[H_CONST_DIV]   = { H_CONST, H_DIV },
+};
+
+const struct h_quickening h_quickenings[H_INSTR_TYPE_COUNT] = {
+	[H_ADD_INTEGERS]    = { H_ADD,          H_NUMBER_INTEGER },
+	[H_SUB_INTEGERS]    = { H_SUB,          H_NUMBER_INTEGER },
+	[H_MUL_INTEGERS]    = { H_MUL,          H_NUMBER_INTEGER },
+	[H_DIV_INTEGERS]    = { H_DIV,          H_NUMBER_INTEGER },
+	[H_EQUALS_INTEGERS] = { H_EQUALS,       H_NUMBER_INTEGER },
+	[H_MORE_INTEGERS]   = { H_MORE,         H_NUMBER_INTEGER },
+	[H_LESS_INTEGERS]   = { H_LESS,         H_NUMBER_INTEGER },
+	[H_ADD_REALS]       = { H_ADD,          H_NUMBER_REAL },
+	[H_SUB_REALS]       = { H_SUB,          H_NUMBER_REAL },
+	[H_MUL_REALS]       = { H_MUL,          H_NUMBER_REAL },
+	[H_DIV_REALS]       = { H_DIV,          H_NUMBER_REAL },
+	[H_EQUALS_REALS]    = { H_EQUALS,       H_NUMBER_REAL },
+	[H_MORE_REALS]      = { H_MORE,         H_NUMBER_REAL },
+	[H_LESS_REALS]      = { H_LESS,         H_NUMBER_REAL },
+	[H_CALL_FUNCTION]   = { H_CALL_SUMBOIL, H_NUMBER_INTEGER },
+};
+
+#define UNKNOWN_TYPE -1
+
+static void* allocate(struct h_arena* arena, size_t size)
+{
+	return arena != NULL ? h_arena_alloc(arena, size) : malloc(size);
+}
+
+struct h_program* h_program_create(struct h_arena* arena)
+{
+	struct h_program* program = allocate(arena, sizeof(struct h_program));
+
+	*program = (struct h_program) {
+		.ref_count = 1,
+		.arena     = arena,
+		.code      = { .arena = arena },
+		.constants = { .arena = arena },
+		.symbols   = { .arena = arena },
+		.lines     = { .arena = arena },
+	};
+
+	return program;
+}
+
+void h_program_retain(struct h_program* program)
+{
+	__atomic_fetch_add(&program->ref_count, 1, __ATOMIC_RELAXED);
+}
+
+void h_program_release(struct h_program* program)
+{
+	if (__atomic_sub_fetch(&program->ref_count, 1, __ATOMIC_ACQ_REL) != 0)
+		return;
+
+	h_jit_release(program);
+
+	if (program->arena != NULL)
+		return;
+
+	free(program->code.ops);
+	free(program->lines.lines);
+	h_value_stack_free(&program->constants);
+	h_symbol_stack_free(&program->symbols);
+	free(program->slots);
+
+	free(program);
+}
+
+struct h_source h_program_source(const struct h_program* program, size_t offset)
+{
+	const struct h_line* lines = program->lines.lines;
+	size_t low                 = 0;
+	size_t high                = program->lines.count;
+
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+
+		if (lines[middle].offset <= offset)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	if (low == 0)
+		return (struct h_source) { .source_type = H_ERROR_SOURCE_NONE };
+
+	return (struct h_source) {
+		.source_type = H_ERROR_SOURCE_TEXT_FILE,
+		.source.text_source.code_pos = lines[low - 1].code_pos,
+	};
+}
+
+struct interner {
+	struct h_symbol_stack* symbols;
+
+	size_t* slots;
+	size_t capacity;
+};
+
+static struct h_symbol_stack global_symbols;
+static struct interner global_interner = { .symbols = &global_symbols };
+
+static size_t hash_name(const char* name)
+{
+	size_t hash = 14695981039346656037ull;
+
+	for (; *name != '\0'; name++)
+		hash = (hash ^ (unsigned char) *name) * 1099511628211ull;
+
+	return hash;
+}
+
+static void interner_insert(struct interner* interner, const char* name, size_t index)
+{
+	size_t mask = interner->capacity - 1;
+	size_t slot = hash_name(name) & mask;
+
+	while (interner->slots[slot] != 0)
+		slot = (slot + 1) & mask;
+
+	interner->slots[slot] = index + 1;
+}
+
+static bool interner_find(const struct interner* interner, const char* name, uint32_t* index)
+{
+	if (interner->capacity == 0)
+		return false;
+
+	size_t mask = interner->capacity - 1;
+
+	for (size_t slot = hash_name(name) & mask; interner->slots[slot] != 0; slot = (slot + 1) & mask) {
+		if (strcmp(interner->symbols->names[interner->slots[slot] - 1], name) == 0) {
+			*index = interner->slots[slot] - 1;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static uint32_t intern(struct interner* interner, const char* name)
+{
+	uint32_t index;
+	if (interner_find(interner, name, &index))
+		return index;
+
+	if ((interner->symbols->count + 1) * 2 > interner->capacity) {
+		free(interner->slots);
+
+		interner->capacity = interner->capacity == 0 ? 16 : interner->capacity * 2;
+		interner->slots    = calloc(interner->capacity, sizeof(size_t));
+
+		for (size_t i = 0; i < interner->symbols->count; i++)
+			interner_insert(interner, interner->symbols->names[i], i);
+	}
+
+	h_symbol_stack_push(interner->symbols, name);
+	interner_insert(interner, name, interner->symbols->count - 1);
+
+	return interner->symbols->count - 1;
+}
+
+uint32_t h_intern(const char* name)
+{
+	return intern(&global_interner, name);
+}
+
+bool h_find_symbol(const char* name, uint32_t* slot)
+{
+	return interner_find(&global_interner, name, slot);
+}
+
+void h_program_link(struct h_program* program)
+{
+	size_t size      = program->symbols.count * sizeof(uint32_t);
+	size_t site_size = program->code.count * sizeof(struct h_jit_site);
+
+	program->slots     = program->arena != NULL ? h_arena_alloc(program->arena, size) : malloc(size);
+	program->jit_sites = program->arena != NULL ? h_arena_alloc(program->arena, site_size) : malloc(site_size);
+
+	memset(program->jit_sites, 0, site_size);
+
+	for (size_t i = 0; i < program->symbols.count; i++)
+		program->slots[i] = h_intern(program->symbols.names[i]);
+}
+
+size_t h_op_operands(enum h_instr_type type)
+{
+	switch (type) {
+	case H_CONST:
+	case H_CREATE_VARIABLE:
+	case H_CALL_SUMBOIL:
+		return 1;
+
+	default:
+		if ((unsigned) type >= H_INSTR_TYPE_COUNT || h_fusions[type].first == H_VALUE)
+			return 0;
+
+		return h_op_operands(h_fusions[type].first) + h_op_operands(h_fusions[type].second);
+	}
+}
+
+enum h_instr_type h_op_generic(enum h_instr_type type)
+{
+	if ((unsigned) type >= H_INSTR_TYPE_COUNT || h_quickenings[type].generic == H_VALUE)
+		return type;
+
+	return h_quickenings[type].generic;
+}
+
+static bool fuse(struct h_program* program, size_t at)
+{
+#ifndef H_PROFILE_OPS
+	struct h_op* first  = &program->code.ops[at - 1];
+	struct h_op* second = &program->code.ops[at];
+	size_t operands     = h_op_operands(first->type);
+
+	if (operands != 0 && h_op_operands(second->type) != 0 && second->operand != first->operand + operands)
+		return false;
+
+	for (size_t type = 0; type < H_INSTR_TYPE_COUNT; type++) {
+		if (h_fusions[type].first != first->type || h_fusions[type].second != second->type)
+			continue;
+
+		*first = (struct h_op) { .type = type, .operand = operands != 0 ? first->operand : second->operand };
+		program->code.count--;
+
+		struct h_line* lines = program->lines.lines;
+		size_t count         = program->lines.count;
+
+		if (count != 0 && lines[count - 1].offset == at) {
+			if (count > 1 && lines[count - 2].offset == at - 1) {
+				lines[count - 2].code_pos = lines[count - 1].code_pos;
+				program->lines.count--;
+			} else {
+				lines[count - 1].offset = at - 1;
+			}
+		}
+
+		return true;
+	}
+#endif
+
+	return false;
+}
+
+static void emit(struct h_program* program, const struct h_instr* instr, struct h_op op)
+{
+	struct h_code_pos code_pos = instr->source.source.text_source.code_pos;
+	const struct h_line* last  = program->lines.count != 0 ? &program->lines.lines[program->lines.count - 1]
+		: NULL;
+
+	if (instr->source.source_type == H_ERROR_SOURCE_TEXT_FILE && (last == NULL
+				|| last->code_pos.line != code_pos.line || last->code_pos.line_pos != code_pos.line_pos))
+		h_line_stack_push(&program->lines, &(struct h_line) {
+			.offset   = program->code.count,
+			.code_pos = code_pos,
+		});
+
+	h_op_stack_push(&program->code, &op);
+}
+
+static void lower(struct h_program* program, struct interner* interner, const struct h_instr_stack* instr_stack)
+{
+	size_t previous = SIZE_MAX;
+
+	for (size_t i = 0; i < instr_stack->count; i++) {
+		const struct h_instr* instr = &instr_stack->instrs[i];
+		size_t at                   = program->code.count;
+
+		switch (instr->type) {
+		case H_VALUE:
+			emit(program, instr, (struct h_op) { .type = H_CONST, .operand = program->constants.count });
+
+			h_value_retain(&instr->value.value);
+			h_value_stack_push(&program->constants, &instr->value.value);
+
+			break;
+
+		case H_ARRAY_DEF:
+		case H_FUNCTION_DEF:
+			emit(program, instr, (struct h_op) { .type = instr->type });
+
+			lower(program, interner, instr->type == H_ARRAY_DEF ? &instr->value.array_def
+					: &instr->value.function_def);
+
+			program->code.ops[at].operand = program->code.count - at - 1;
+			previous                      = SIZE_MAX;
+
+			continue;
+
+		case H_CREATE_VARIABLE:
+		case H_CALL_SUMBOIL:
+			emit(program, instr, (struct h_op) { .type = instr->type,
+					.operand = intern(interner, instr->value.sumboil) });
+			break;
+
+		default:
+			emit(program, instr, (struct h_op) { .type = instr->type });
+			break;
+		}
+
+		if (previous != SIZE_MAX && previous == at - 1 && fuse(program, at))
+			at = previous;
+
+		previous = at;
+	}
+}
+
+static bool is_number_op(enum h_instr_type type)
+{
+	switch (type) {
+	case H_ADD:
+	case H_SUB:
+	case H_MUL:
+	case H_DIV:
+	case H_POW:
+	case H_EQUALS:
+	case H_NOT_EQUALS:
+	case H_MORE:
+	case H_LESS:
+	case H_MORE_OR_EQUALS:
+	case H_LESS_OR_EQUALS:
+	case H_AND:
+	case H_OR:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+static void stack_effect(enum h_instr_type type, size_t* pops, size_t* pushes)
+{
+	size_t first_pops, first_pushes, second_pops, second_pushes;
+
+	*pops   = 0;
+	*pushes = 1;
+
+	if (is_number_op(type)) {
+		*pops = 2;
+		return;
+	}
+
+	switch (type) {
+	case H_CONST:
+	case H_IMAGINARITY_CONST:
+	case H_ARRAY_DEF:
+	case H_FUNCTION_DEF:
+		break;
+
+	case H_REAL:
+	case H_IMAG:
+	case H_NOT:
+	case H_ARR_POP:
+	case H_ARR_FLIP:
+	case H_ARR_COPY:
+		*pops = 1;
+		break;
+
+	case H_POP:
+	case H_CREATE_VARIABLE:
+		*pops   = 1;
+		*pushes = 0;
+		break;
+
+	case H_COPY:
+	case H_ARR_GET:
+		*pops   = 1;
+		*pushes = 2;
+		break;
+
+	case H_FLIP:
+		*pops   = 2;
+		*pushes = 2;
+		break;
+
+	case H_ARR_PUSH:
+	case H_ARR_CAT:
+	case H_ARR_TAKE:
+	case H_ARR_DROP:
+	case H_ARR_STEP:
+	case H_RANGE:
+	case H_REDUCE:
+	case H_ENUMERATE:
+		*pops = 2;
+		break;
+
+	default:
+		if ((unsigned) type >= H_INSTR_TYPE_COUNT || h_fusions[type].first == H_VALUE) {
+			*pushes = 0;
+			break;
+		}
+
+		stack_effect(h_fusions[type].first, &first_pops, &first_pushes);
+		stack_effect(h_fusions[type].second, &second_pops, &second_pushes);
+
+		*pops   = first_pops + (second_pops > first_pushes ? second_pops - first_pushes : 0);
+		*pushes = (first_pushes > second_pops ? first_pushes - second_pops : 0) + second_pushes;
+		break;
+	}
+}
+
+static int peek_type(const struct h_base_stack* types, size_t depth)
+{
+	return types->count > depth ? ((int*) types->ptr)[types->count - 1 - depth] : UNKNOWN_TYPE;
+}
+
+static int pop_type(struct h_base_stack* types)
+{
+	return types->count != 0 ? ((int*) types->ptr)[--types->count] : UNKNOWN_TYPE;
+}
+
+static void push_type(struct h_base_stack* types, int type)
+{
+	h_base_stack_push(types, &type, sizeof(int));
+}
+
+static void apply_types(const struct h_program* program, struct h_base_stack* types, enum h_instr_type type,
+		uint32_t operand)
+{
+	int type0, type1;
+
+	if (is_number_op(type)) {
+		pop_type(types);
+		pop_type(types);
+		push_type(types, H_NUMBER);
+
+		return;
+	}
+
+	switch (type) {
+	case H_CONST:
+		push_type(types, h_value_get_type(&program->constants.value[operand]));
+		break;
+
+	case H_IMAGINARITY_CONST:
+		push_type(types, H_NUMBER);
+		break;
+
+	case H_REAL:
+	case H_IMAG:
+	case H_NOT:
+		pop_type(types);
+		push_type(types, H_NUMBER);
+		break;
+
+	case H_POP:
+	case H_CREATE_VARIABLE:
+		pop_type(types);
+		break;
+
+	case H_COPY:
+		type0 = pop_type(types);
+		push_type(types, type0);
+		push_type(types, type0);
+		break;
+
+	case H_FLIP:
+		type0 = pop_type(types);
+		type1 = pop_type(types);
+		push_type(types, type0);
+		push_type(types, type1);
+		break;
+
+	case H_ARR_GET:
+		pop_type(types);
+		push_type(types, H_ARRAY);
+		push_type(types, UNKNOWN_TYPE);
+		break;
+
+	case H_ARR_PUSH:
+	case H_ARR_CAT:
+	case H_ARR_TAKE:
+	case H_ARR_DROP:
+	case H_ARR_STEP:
+	case H_RANGE:
+		pop_type(types);
+		pop_type(types);
+		push_type(types, H_ARRAY);
+		break;
+
+	case H_ARR_POP:
+	case H_ARR_FLIP:
+	case H_ARR_COPY:
+		pop_type(types);
+		push_type(types, H_ARRAY);
+		break;
+
+	case H_ENUMERATE:
+		types->count = 0;
+		push_type(types, H_ARRAY);
+		break;
+
+	default:
+		if ((unsigned) type < H_INSTR_TYPE_COUNT && h_fusions[type].first != H_VALUE) {
+			apply_types(program, types, h_fusions[type].first, operand);
+			apply_types(program, types, h_fusions[type].second, operand + h_op_operands(h_fusions[type].first));
+
+			break;
+		}
+
+		types->count = 0;
+		break;
+	}
+}
+
+static size_t verify_block(struct h_program* program, struct h_op* op, const struct h_op* end, bool is_reached,
+		struct h_error* error)
+{
+	struct h_base_stack types = {0};
+	size_t height             = 0;
+
+	for (; op < end; op++) {
+		if (op->type == H_NUMBER_OP)
+			*op = (struct h_op) { .type = op->operand };
+
+		size_t pops, pushes;
+		stack_effect(op->type, &pops, &pushes);
+
+		op->flags  = pops <= types.count ? H_OP_VERIFIED : 0;
+		op->height = 0;
+
+		if (op->type == H_ARRAY_DEF || op->type == H_FUNCTION_DEF) {
+			size_t body_height = verify_block(program, op + 1, op + 1 + op->operand,
+					is_reached && op->type == H_ARRAY_DEF, error);
+
+			op->height = body_height < UINT16_MAX ? body_height : UINT16_MAX;
+
+			if (op->type == H_ARRAY_DEF)
+				types.count = 0;
+
+			push_type(&types, op->type == H_ARRAY_DEF ? H_ARRAY : H_FUNCTION);
+			op += op->operand;
+
+			continue;
+		}
+
+		int type0 = peek_type(&types, 0);
+		int type1 = peek_type(&types, 1);
+
+		if (is_number_op(op->type) && type0 == H_NUMBER && type1 == H_NUMBER)
+			*op = (struct h_op) { .type = H_NUMBER_OP, .flags = op->flags, .operand = op->type };
+		else if (is_number_op(op->type) && is_reached && types.count >= 2 && error->type == H_OK
+				&& type0 != UNKNOWN_TYPE && (type0 != H_NUMBER || type1 != UNKNOWN_TYPE))
+			*error = (struct h_error) {
+				.type   = H_ERROR_TYPE_ERROR,
+				.source = h_program_source(program, op - program->code.ops),
+				.value.type_error.excepted = H_NUMBER,
+				.value.type_error.got      = type0 != H_NUMBER ? type0 : type1,
+			};
+
+		apply_types(program, &types, op->type == H_NUMBER_OP ? op->operand : op->type, op->operand);
+
+		if (types.count > height)
+			height = types.count;
+	}
+
+	free(types.ptr);
+
+	return height;
+}
+
+struct h_error h_verify_program(struct h_program* program)
+{
+	struct h_error error = { .type = H_OK };
+
+	program->height = verify_block(program, program->code.ops, program->code.ops + program->code.count, true,
+			&error);
+
+	return error;
+}
+
+struct h_program* h_compile(const struct h_instr_stack* instr_stack)
+{
+	struct h_program* program = h_program_create(instr_stack->arena);
+	struct interner interner  = { .symbols = &program->symbols };
+
+	lower(program, &interner, instr_stack);
+
+	free(interner.slots);
+
+	h_program_link(program);
+	h_verify_program(program);
+
+	return program;
+}
@@ -65,6 +65,8 @@ static const char* get_error_message(enum h_error_type type)
 		return "Can't apply reduce to array with value count less 2";
 	case H_ERROR_BYTECODE_READ_ERROR:
 		return "Can't read bytecode, file format corrupted";
+	case H_ERROR_INVALID_ARRAY_STEP:
+		return "Array step must be positive";
 	}
 }
 
@@ -18,10 +18,15 @@
 
 #include "h.h"
 
-#define SMALL_USAGE "usage: [-h][-c][-i file][-o file][-a code]\n"
+#define SMALL_USAGE "usage: [-h][-c][-s][-r][-q][-j][-O level][-i file][-o file][-a code]\n"
 #define USAGE \
 	"  -h		print help message\n" \
 	"  -c		compile source file into bytecode\n" \
+	"  -s		print runtime statistics after execution\n" \
+	"  -r		run function bodies on the register machine when possible\n" \
+	"  -q		specialize instructions for the operand types they first see\n" \
+	"  -j		compile hot function bodies to native code\n" \
+	"  -O level	optimize function bodies on the register machine\n" \
 	"  -i file 	specify input file\n" \
 	"  -o file	specify output file\n" \
 	"  -a code	code executed before main program for specify arguments\n"
@@ -34,7 +39,8 @@ static void usage(FILE* stream, bool small)
 #define continue_or_return_if_error(x) ({ struct h_error __x = (x); if (__x.type != H_OK) return __x; })
 #define return_ok() return (struct h_error) { .type = H_OK }
 
-static struct h_error read_instrs_text(const char* path, struct h_instr_stack* instrs, bool* is_found)
+static struct h_error read_instrs_text(const char* path, const char* prelude, struct h_program** program,
+		bool* is_found)
 {
 	FILE* file = fopen(path, "r");
 
@@ -54,16 +60,33 @@ static struct h_error read_instrs_text(const char* path, struct h_instr_stack* i
 
 	fclose(file);
 
-	continue_or_return_if_error(h_parse_code(instrs, text));
+	struct h_instr_stack instrs = {0};
+	struct h_error error        = {0};
+
+	if (prelude != NULL)
+		error = h_parse_code(&instrs, prelude);
+
+	if (error.type == H_OK)
+		error = h_parse_code(&instrs, text);
 
 	free(text);
 
+	if (error.type != H_OK) {
+		h_instr_stack_free(&instrs);
+		return error;
+	}
+
+	h_optimize(&instrs);
+
+	*program = h_compile(&instrs);
+	h_instr_stack_free(&instrs);
+
 	*is_found = true;
 
 	return_ok();
 }
 
-static struct h_error read_instrs(const char* path, struct h_instr_stack* instrs, bool* is_found)
+static struct h_error read_instrs(const char* path, struct h_program** program, bool* is_found)
 {
 	FILE* file = fopen(path, "rb");
 
@@ -72,19 +95,27 @@ static struct h_error read_instrs(const char* path, struct h_instr_stack* instrs
 		return_ok();
 	}
 
-	if (h_read_bytecode(file, instrs).type == H_OK) {
+	*program = h_program_create(NULL);
+
+	if (h_read_bytecode(file, *program).type == H_OK) {
 		fclose(file);
 		*is_found = true;
 
 		return_ok();
 	}
 
-	continue_or_return_if_error(read_instrs_text(path, instrs, is_found));
+	fclose(file);
+
+	h_program_release(*program);
+	*program = NULL;
+
+	continue_or_return_if_error(read_instrs_text(path, NULL, program, is_found));
 	
 	return_ok();
 }
 
 #define MAX_ERROR_LENGTH 512
+#define MAX_PROFILED_OP_PAIRS 32
 
 static void print_error(const struct h_error* error)
 {
@@ -95,7 +126,22 @@ static void print_error(const struct h_error* error)
 	fprintf(stderr, "%s", buf);
 }
 
-#define MAX_STACK_VALUE_LENGHT 2048
+static void print_runtime_stats(const struct h_runtime* runtime, size_t quickened)
+{
+	size_t hits   = runtime->sumboil_stack.cache_hits;
+	size_t misses = runtime->sumboil_stack.cache_misses;
+
+	fprintf(stderr, "sumboil cache: %zu hits, %zu misses (%.1f%% hit rate)\n", hits, misses,
+			hits + misses != 0 ? 100.0 * hits / (hits + misses) : 0.0);
+
+	if (runtime->quickening)
+		fprintf(stderr, "quickened instructions: %zu\n", quickened);
+
+#ifdef H_PROFILE_OPS
+	fprintf(stderr, "most frequent op pairs:\n");
+	h_write_op_profile(stderr, MAX_PROFILED_OP_PAIRS);
+#endif
+}
 
 int main(int argc, char* argv[])
 {
@@ -103,14 +149,50 @@ int main(int argc, char* argv[])
 	const char* input     = NULL;
 	const char* prog_args = NULL;
 	bool compile_mode     = false;
+	bool print_stats      = false;
+	bool register_vm      = false;
+	bool quickening       = false;
+	bool jit              = false;
+	unsigned level        = 0;
 
 	char c;
-	while ((c = getopt(argc, argv, "co:i:a:h")) != -1) {
+	while ((c = getopt(argc, argv, "csrqjO:o:i:a:h")) != -1) {
 		switch (c) {
 		case 'c':
 			compile_mode = true;
 			break;
 
+		case 's':
+			print_stats = true;
+			break;
+
+		case 'r':
+			register_vm = true;
+			break;
+
+		case 'q':
+			quickening = true;
+			break;
+
+		case 'j':
+			jit         = true;
+			register_vm = true;
+			break;
+
+		case 'O': {
+			char* end;
+			unsigned long parsed = strtoul(optarg, &end, 10);
+
+			if (*optarg < '0' || *optarg > '9' || *end != '\0' || parsed > 2) {
+				usage(stderr, true);
+				return 1;
+			}
+
+			level       = parsed;
+			register_vm = register_vm || level != 0;
+			break;
+		}
+
 		case 'o':
 			out = optarg;
 			break;
@@ -144,13 +226,11 @@ int main(int argc, char* argv[])
 			return 1;
 		}
 
-		struct h_instr_stack instrs = {0};
-		struct h_error error        = {0};
-		bool is_found               = false;
-
-		if ((error = read_instrs_text(input, &instrs, &is_found)).type != H_OK) {
-			h_instr_stack_free(&instrs);
+		struct h_program* program = NULL;
+		struct h_error error      = {0};
+		bool is_found             = false;
 
+		if ((error = read_instrs_text(input, prog_args, &program, &is_found)).type != H_OK) {
 			print_error(&error);
 			return 1;
 		}
@@ -160,16 +240,30 @@ int main(int argc, char* argv[])
 			return 1;
 		}
 
+		if ((error = h_verify_program(program)).type != H_OK) {
+			print_error(&error);
+			h_program_release(program);
+
+			return 1;
+		}
+
 		FILE* file = fopen(out, "wb");
 
-		h_write_bytecode(file, &instrs);
+		h_write_bytecode(file, program);
 
 		fclose(file);
 
+		h_program_release(program);
+
 		return 0;
 	}
 
-	struct h_runtime runtime = {0};
+	struct h_runtime runtime;
+	h_create_runtime(&runtime, NULL);
+	runtime.register_vm        = register_vm;
+	runtime.optimization_level = level;
+	runtime.quickening         = quickening;
+	runtime.jit                = jit;
 
 	if (prog_args != NULL) {
 		struct h_instr_stack instrs = {0};
@@ -183,8 +277,7 @@ int main(int argc, char* argv[])
 		}
 
 		if ((error = h_execute_instr_stack(&instrs, &runtime)).type != H_OK) {
-			h_value_stack_free(&runtime.value_stack);
-			h_sumboil_stack_free(&runtime.sumboil_stack);
+			h_free_runtime(&runtime);
 			h_instr_stack_free(&instrs);
 
 			print_error(&error);
@@ -194,13 +287,11 @@ int main(int argc, char* argv[])
 		h_instr_stack_free(&instrs);
 	}
 
-	struct h_instr_stack instrs = {0};
-	struct h_error error        = {0};
-	bool is_found               = false;
+	struct h_program* program = NULL;
+	struct h_error error      = {0};
+	bool is_found             = false;
 	
-	if ((error = read_instrs(input, &instrs, &is_found)).type != H_OK) {
-		h_instr_stack_free(&instrs);
-
+	if ((error = read_instrs(input, &program, &is_found)).type != H_OK) {
 		print_error(&error);
 		return 1;
 	}
@@ -210,24 +301,27 @@ int main(int argc, char* argv[])
 		return 1;
 	}
 
-	if ((error = h_execute_instr_stack(&instrs, &runtime)).type != H_OK) {
-		h_value_stack_free(&runtime.value_stack);
-		h_sumboil_stack_free(&runtime.sumboil_stack);
-		h_instr_stack_free(&instrs);
+	if ((error = h_execute_program(program, &runtime)).type != H_OK) {
+		h_free_runtime(&runtime);
+		h_program_release(program);
 
 		print_error(&error);
 		return 1;
 	}
 
-	h_instr_stack_free(&instrs);
+	size_t quickened = program->quickened;
+
+	h_program_release(program);
+
+	char* output = h_value_stack_to_string(&runtime.value_stack);
 
-	char buf[MAX_STACK_VALUE_LENGHT];
-	h_value_stack_to_string_buf(&runtime.value_stack, buf, sizeof(buf));
+	printf("%s", output);
+	free(output);
 
-	printf("%s", buf);
+	if (print_stats)
+		print_runtime_stats(&runtime, quickened);
 
-	h_value_stack_free(&runtime.value_stack);
-	h_sumboil_stack_free(&runtime.sumboil_stack);
+	h_free_runtime(&runtime);
 
 	return 0;
 }
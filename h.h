@@ -25,9 +25,31 @@
 #define H_MAX_SUBCODE_LENGHT 512
 #define H_MAX_STRING_LITERAL_LENGHT 256
 
+#define H_MIN_STACK_CAPACITY 8
+#define H_ARENA_CHUNK_SIZE (64 * 1024)
+#define H_TREE_LEAF_SIZE 32
+#define H_ARRAY_TREE_THRESHOLD 64
+#define H_MAX_EXACT_INTEGER 9007199254740992
+#define H_MAX_REGISTERS 64
+#define H_JIT_THRESHOLD 256
+
+struct h_arena_chunk {
+	struct h_arena_chunk* next;
+	size_t size;
+	size_t used;
+
+	_Alignas(max_align_t) char data[];
+};
+
+struct h_arena {
+	struct h_arena_chunk* chunks;
+};
+
 struct h_base_stack {
 	void* ptr;
 	size_t count;
+	size_t capacity;
+	struct h_arena* arena;
 
 	struct h_base_stack* root_stack;
 };
@@ -39,9 +61,26 @@ enum h_value_type {
 	H_CHAR,
 };
 
+enum h_number_kind {
+	H_NUMBER_INTEGER = 0,
+	H_NUMBER_REAL,
+	H_NUMBER_COMPLEX,
+	H_NUMBER_BIG,
+};
+
+struct h_bignum {
+	size_t ref_count;
+	bool negative;
+	size_t count;
+
+	uint32_t limbs[];
+};
+
 struct h_instr_stack {
 	struct h_instr* instrs;
 	size_t count;
+	size_t capacity;
+	struct h_arena* arena;
 
 	struct h_instr_stack* root_stack;
 };
@@ -49,20 +88,329 @@ struct h_instr_stack {
 struct h_value_stack {
 	struct h_value* value;
 	size_t count;
+	size_t capacity;
+	struct h_arena* arena;
 
 	struct h_value_stack* root_stack;
 };
 
+struct h_function {
+	size_t ref_count;
+	struct h_arena* arena;
+
+	struct h_program* program;
+	size_t offset;
+	size_t count;
+};
+
+struct h_real_stack {
+	double* reals;
+	size_t count;
+	size_t capacity;
+	struct h_arena* arena;
+
+	struct h_real_stack* root_stack;
+};
+
+struct h_complex_stack {
+	double complex* complexes;
+	size_t count;
+	size_t capacity;
+	struct h_arena* arena;
+
+	struct h_complex_stack* root_stack;
+};
+
+struct h_integer_stack {
+	int64_t* integers;
+	size_t count;
+	size_t capacity;
+	struct h_arena* arena;
+
+	struct h_integer_stack* root_stack;
+};
+
+struct h_byte_stack {
+	char* bytes;
+	size_t count;
+	size_t capacity;
+	struct h_arena* arena;
+
+	struct h_byte_stack* root_stack;
+};
+
+enum h_array_kind {
+	H_ARRAY_VALUES = 0,
+	H_ARRAY_INTEGERS,
+	H_ARRAY_REALS,
+	H_ARRAY_COMPLEXES,
+	H_ARRAY_BYTES,
+	H_ARRAY_TREE,
+	H_ARRAY_VIEW,
+};
+
+struct h_array_view {
+	struct h_array* base;
+	size_t offset;
+	size_t count;
+	size_t stride;
+};
+
+struct h_array {
+	size_t ref_count;
+	enum h_array_kind kind;
+	struct h_arena* arena;
+
+	union {
+		struct h_base_stack base;
+		struct h_value_stack values;
+		struct h_integer_stack integers;
+		struct h_real_stack reals;
+		struct h_complex_stack complexes;
+		struct h_byte_stack bytes;
+		struct h_tree_node* tree;
+		struct h_array_view view;
+	} data;
+};
+
+#ifdef H_COMPACT_VALUES
+#define H_VALUE_TAG_FUNCTION 0xfff9000000000000
+#define H_VALUE_TAG_ARRAY    0xfffa000000000000
+#define H_VALUE_TAG_CHAR     0xfffb000000000000
+#define H_VALUE_TAG_INTEGER  0xfffc000000000000
+#define H_VALUE_TAG_BIGNUM   0xfffd000000000000
+#define H_VALUE_CANONICAL_NAN 0x7ff8000000000000
+
+struct h_value {
+	union {
+		double real;
+		int64_t integer;
+		struct h_bignum* bignum;
+		struct h_function* function;
+		struct h_array* array;
+		char charester;
+	} value;
+
+	union {
+		double imag;
+		uint64_t tag;
+	} box;
+};
+#else
 struct h_value {
 	enum h_value_type type;
+	enum h_number_kind number_kind;
 
 	union {
 		double complex number;
-		struct h_instr_stack function;
-		struct h_value_stack array;
+		int64_t integer;
+		struct h_bignum* bignum;
+		struct h_function* function;
+		struct h_array* array;
 		char charester;
 	} value;
 };
+#endif
+
+double h_bignum_to_double(const struct h_bignum* bignum);
+
+#ifdef H_COMPACT_VALUES
+static inline enum h_value_type h_value_get_type(const struct h_value* value)
+{
+	switch (value->box.tag) {
+	case H_VALUE_TAG_FUNCTION: return H_FUNCTION;
+	case H_VALUE_TAG_ARRAY: return H_ARRAY;
+	case H_VALUE_TAG_CHAR: return H_CHAR;
+	default: return H_NUMBER;
+	}
+}
+
+static inline enum h_number_kind h_value_get_number_kind(const struct h_value* value)
+{
+	if (value->box.tag == H_VALUE_TAG_INTEGER)
+		return H_NUMBER_INTEGER;
+
+	if (value->box.tag == H_VALUE_TAG_BIGNUM)
+		return H_NUMBER_BIG;
+
+	return value->box.imag == 0 ? H_NUMBER_REAL : H_NUMBER_COMPLEX;
+}
+
+static inline int64_t h_value_get_integer(const struct h_value* value)
+{
+	return value->value.integer;
+}
+
+static inline double h_value_get_real(const struct h_value* value)
+{
+	if (value->box.tag == H_VALUE_TAG_INTEGER)
+		return value->value.integer;
+
+	if (value->box.tag == H_VALUE_TAG_BIGNUM)
+		return h_bignum_to_double(value->value.bignum);
+
+	return value->value.real;
+}
+
+static inline double complex h_value_get_number(const struct h_value* value)
+{
+	if (value->box.tag == H_VALUE_TAG_INTEGER)
+		return value->value.integer;
+
+	if (value->box.tag == H_VALUE_TAG_BIGNUM)
+		return h_bignum_to_double(value->value.bignum);
+
+	return CMPLX(value->value.real, value->box.imag);
+}
+
+static inline struct h_value h_make_integer(int64_t integer)
+{
+	return (struct h_value) { .value.integer = integer, .box.tag = H_VALUE_TAG_INTEGER };
+}
+
+static inline struct h_value h_make_bignum(struct h_bignum* bignum)
+{
+	return (struct h_value) { .value.bignum = bignum, .box.tag = H_VALUE_TAG_BIGNUM };
+}
+
+static inline struct h_value h_make_real(double real)
+{
+	return (struct h_value) { .value.real = real, .box.imag = 0 };
+}
+
+static inline struct h_value h_make_number(double complex number)
+{
+	struct h_value value = { .value.real = creal(number), .box.imag = cimag(number) };
+
+	if (value.box.imag != value.box.imag)
+		value.box.tag = H_VALUE_CANONICAL_NAN;
+
+	return value;
+}
+
+static inline struct h_value h_make_function(struct h_function* function)
+{
+	return (struct h_value) { .value.function = function, .box.tag = H_VALUE_TAG_FUNCTION };
+}
+
+static inline struct h_value h_make_array(struct h_array* array)
+{
+	return (struct h_value) { .value.array = array, .box.tag = H_VALUE_TAG_ARRAY };
+}
+
+static inline struct h_value h_make_char(char charester)
+{
+	return (struct h_value) { .value.charester = charester, .box.tag = H_VALUE_TAG_CHAR };
+}
+#else
+static inline enum h_value_type h_value_get_type(const struct h_value* value)
+{
+	return value->type;
+}
+
+static inline enum h_number_kind h_value_get_number_kind(const struct h_value* value)
+{
+	return value->number_kind;
+}
+
+static inline int64_t h_value_get_integer(const struct h_value* value)
+{
+	return value->value.integer;
+}
+
+static inline double h_value_get_real(const struct h_value* value)
+{
+	if (value->number_kind == H_NUMBER_INTEGER)
+		return value->value.integer;
+
+	if (value->number_kind == H_NUMBER_BIG)
+		return h_bignum_to_double(value->value.bignum);
+
+	return creal(value->value.number);
+}
+
+static inline double complex h_value_get_number(const struct h_value* value)
+{
+	if (value->number_kind == H_NUMBER_INTEGER)
+		return value->value.integer;
+
+	if (value->number_kind == H_NUMBER_BIG)
+		return h_bignum_to_double(value->value.bignum);
+
+	return value->value.number;
+}
+
+static inline struct h_value h_make_integer(int64_t integer)
+{
+	return (struct h_value) { .type = H_NUMBER, .number_kind = H_NUMBER_INTEGER, .value.integer = integer };
+}
+
+static inline struct h_value h_make_bignum(struct h_bignum* bignum)
+{
+	return (struct h_value) { .type = H_NUMBER, .number_kind = H_NUMBER_BIG, .value.bignum = bignum };
+}
+
+static inline struct h_value h_make_real(double real)
+{
+	return (struct h_value) { .type = H_NUMBER, .number_kind = H_NUMBER_REAL, .value.number = real };
+}
+
+static inline struct h_value h_make_number(double complex number)
+{
+	return (struct h_value) {
+		.type         = H_NUMBER,
+		.number_kind  = cimag(number) == 0 ? H_NUMBER_REAL : H_NUMBER_COMPLEX,
+		.value.number = number,
+	};
+}
+
+static inline struct h_value h_make_function(struct h_function* function)
+{
+	return (struct h_value) { .type = H_FUNCTION, .value.function = function };
+}
+
+static inline struct h_value h_make_array(struct h_array* array)
+{
+	return (struct h_value) { .type = H_ARRAY, .value.array = array };
+}
+
+static inline struct h_value h_make_char(char charester)
+{
+	return (struct h_value) { .type = H_CHAR, .value.charester = charester };
+}
+#endif
+
+static inline struct h_function* h_value_get_function(const struct h_value* value)
+{
+	return value->value.function;
+}
+
+static inline struct h_array* h_value_get_array(const struct h_value* value)
+{
+	return value->value.array;
+}
+
+static inline struct h_bignum* h_value_get_bignum(const struct h_value* value)
+{
+	return value->value.bignum;
+}
+
+static inline char h_value_get_char(const struct h_value* value)
+{
+	return value->value.charester;
+}
+
+struct h_tree_node {
+	size_t ref_count;
+	size_t count;
+	size_t height;
+	struct h_arena* arena;
+
+	struct h_tree_node* left;
+	struct h_tree_node* right;
+
+	struct h_value values[];
+};
 
 struct h_code_pos {
 	size_t line;
@@ -81,10 +429,12 @@ enum h_error_type {
 	H_ERROR_APPLYING_REDUCE_TO_ONE_VALUE_ARRAY,
 	H_ERROR_SUMBOIL_NOT_FOUND,
 	H_ERROR_BYTECODE_READ_ERROR,
+	H_ERROR_INVALID_ARRAY_STEP,
 };
 
 enum h_source_type {
-	H_ERROR_SOURCE_TEXT_FILE = 0,
+	H_ERROR_SOURCE_NONE = 0,
+	H_ERROR_SOURCE_TEXT_FILE,
 	H_ERROR_BYTECODE_FILE,
 };
 
@@ -123,6 +473,7 @@ struct h_value_stack_pop_result {
 
 enum h_instr_type {
 	H_VALUE = 0,
+	H_CONST,
 
 	H_ADD,
 	H_SUB,
@@ -139,12 +490,16 @@ enum h_instr_type {
 	H_COPY,
 
 	H_ARRAY_DEF,
+	H_FUNCTION_DEF,
 	H_ARR_PUSH,
 	H_ARR_GET,
 	H_ARR_POP,
 	H_ARR_FLIP,
 	H_ARR_COPY,
 	H_ARR_CAT,
+	H_ARR_TAKE,
+	H_ARR_DROP,
+	H_ARR_STEP,
 
 	H_EQUALS,
 	H_NOT_EQUALS,
@@ -165,6 +520,35 @@ enum h_instr_type {
 
 	H_CREATE_VARIABLE,
 	H_CALL_SUMBOIL,
+
+	H_CONST_CONST,
+	H_COPY_MUL,
+	H_CONST_RANGE,
+	H_CONST_POW,
+	H_CONST_ADD,
+	H_CONST_SUB,
+	H_CONST_MUL,
+	H_CONST_DIV,
+
+	H_NUMBER_OP,
+
+	H_ADD_INTEGERS,
+	H_SUB_INTEGERS,
+	H_MUL_INTEGERS,
+	H_DIV_INTEGERS,
+	H_EQUALS_INTEGERS,
+	H_MORE_INTEGERS,
+	H_LESS_INTEGERS,
+	H_ADD_REALS,
+	H_SUB_REALS,
+	H_MUL_REALS,
+	H_DIV_REALS,
+	H_EQUALS_REALS,
+	H_MORE_REALS,
+	H_LESS_REALS,
+	H_CALL_FUNCTION,
+
+	H_INSTR_TYPE_COUNT,
 };
 
 struct h_instr {
@@ -174,23 +558,180 @@ struct h_instr {
 	union {
 		struct h_value value;
 		struct h_instr_stack array_def;
+		struct h_instr_stack function_def;
 		char sumboil[H_MAX_SUMBOIL_NAME];
 	} value;
 };
 
+#define H_OP_VERIFIED    1
+#define H_OP_DEOPTIMIZED 2
+
+struct h_op {
+	uint8_t type;
+	uint8_t flags;
+	uint16_t height;
+	uint32_t operand;
+};
+
+static inline enum h_instr_type h_op_type(const struct h_op* op)
+{
+	return __atomic_load_n(&op->type, __ATOMIC_RELAXED);
+}
+
+static inline uint8_t h_op_flags(const struct h_op* op)
+{
+	return __atomic_load_n(&op->flags, __ATOMIC_RELAXED);
+}
+
+struct h_fusion {
+	enum h_instr_type first;
+	enum h_instr_type second;
+};
+
+extern const struct h_fusion h_fusions[H_INSTR_TYPE_COUNT];
+
+struct h_quickening {
+	enum h_instr_type generic;
+	enum h_number_kind kind;
+};
+
+extern const struct h_quickening h_quickenings[H_INSTR_TYPE_COUNT];
+
+struct h_op_stack {
+	struct h_op* ops;
+	size_t count;
+	size_t capacity;
+	struct h_arena* arena;
+
+	struct h_op_stack* root_stack;
+};
+
+struct h_line {
+	size_t offset;
+	struct h_code_pos code_pos;
+};
+
+struct h_line_stack {
+	struct h_line* lines;
+	size_t count;
+	size_t capacity;
+	struct h_arena* arena;
+
+	struct h_line_stack* root_stack;
+};
+
+struct h_symbol_stack {
+	char** names;
+	size_t count;
+	size_t capacity;
+	struct h_arena* arena;
+
+	struct h_symbol_stack* root_stack;
+};
+
+struct h_program {
+	size_t ref_count;
+	struct h_arena* arena;
+
+	struct h_op_stack code;
+	struct h_value_stack constants;
+	struct h_symbol_stack symbols;
+	struct h_line_stack lines;
+
+	uint32_t* slots;
+	struct h_jit_site* jit_sites;
+
+	size_t height;
+	size_t quickened;
+};
+
+static inline const struct h_op* h_function_code(const struct h_function* function)
+{
+	return function->program->code.ops + function->offset;
+}
+
 struct h_sumboil {
-	char name[H_MAX_SUMBOIL_NAME];
+	bool defined;
+	uint32_t version;
 	struct h_value value;
 };
 
+struct h_sumboil_cache {
+	const struct h_sumboil* sumboils;
+	struct h_sumboil* sumboil;
+	uint32_t version;
+};
+
 struct h_sumboil_stack {
 	struct h_sumboil* sumboils;
 	size_t count;
+	size_t capacity;
+	struct h_arena* arena;
+
+	struct h_sumboil_stack* root_stack;
+
+	struct h_sumboil_cache* caches;
+	size_t cache_count;
+
+	size_t cache_hits;
+	size_t cache_misses;
 };
 
 struct h_runtime {
 	struct h_sumboil_stack sumboil_stack;
 	struct h_value_stack value_stack;
+
+	struct h_arena* arena;
+
+	bool register_vm;
+	unsigned optimization_level;
+
+	bool quickening;
+	bool jit;
+};
+
+struct h_register_op {
+	uint8_t type;
+	uint8_t target;
+	uint8_t source0;
+	uint8_t source1;
+	uint32_t operand;
+	uint32_t offset;
+};
+
+struct h_register_code {
+	const struct h_program* program;
+
+	struct h_register_op ops[H_MAX_REGISTERS];
+	size_t count;
+	size_t invariants;
+
+	size_t arguments;
+	size_t temporaries;
+	size_t constants;
+	uint8_t result;
+
+	struct h_value registers[H_MAX_REGISTERS];
+
+	const struct h_native* native;
+};
+
+struct h_native {
+	bool (*entry)(struct h_value* registers);
+	void* memory;
+	size_t size;
+
+	struct h_register_op ops[H_MAX_REGISTERS];
+	size_t count;
+	size_t invariants;
+	size_t arguments;
+	uint8_t result;
+};
+
+struct h_jit_site {
+	size_t heat;
+	bool rejected;
+	struct h_native* native;
 };
 
 enum h_lexer_state {
@@ -250,6 +791,9 @@ enum h_lexer_tok_type {
 	H_TOK_ARR_FLIP,
 	H_TOK_ARR_COPY,
 	H_TOK_ARR_CAT,
+	H_TOK_ARR_TAKE,
+	H_TOK_ARR_DROP,
+	H_TOK_ARR_STEP,
 
 	H_TOK_EQUALS,
 	H_TOK_NOT_EQUALS,
@@ -283,20 +827,98 @@ struct h_lexer_tok {
 	} value;
 };
 
+void* h_arena_alloc(struct h_arena* arena, size_t size);
+void* h_arena_realloc(struct h_arena* arena, void* ptr, size_t old_size, size_t size);
+void h_arena_reset(struct h_arena* arena);
+void h_arena_free(struct h_arena* arena);
+
+void h_base_stack_reserve(struct h_base_stack* stack, size_t count, size_t data_size);
 void h_base_stack_push(struct h_base_stack* stack, const void* data, size_t data_size);
+void h_base_stack_append_n(struct h_base_stack* stack, const void* data, size_t count, size_t data_size);
 void h_base_stack_drop(struct h_base_stack* stack, size_t data_size);
 void* h_base_stack_peek(const struct h_base_stack* stack, size_t data_size);
 
+void h_value_stack_reserve(struct h_value_stack* stack, size_t count);
 void h_value_stack_push(struct h_value_stack* stack, const struct h_value* data);
-struct h_error h_value_stack_drop(struct h_value_stack* stack, const struct h_source* source);
-struct h_value_stack_peek_result h_value_stack_peek(const struct h_value_stack* stack,
-		const struct h_source* source);
-struct h_value_stack_pop_result h_value_stack_pop(struct h_value_stack* stack,
-		const struct h_source* source);
+void h_value_stack_append_n(struct h_value_stack* stack, const struct h_value* data, size_t count);
+struct h_error h_value_stack_drop(struct h_value_stack* stack);
+struct h_value_stack_peek_result h_value_stack_peek(const struct h_value_stack* stack);
+struct h_value_stack_pop_result h_value_stack_pop(struct h_value_stack* stack);
+
+struct h_array* h_array_create(struct h_arena* arena);
+struct h_array* h_array_create_packed(struct h_arena* arena, enum h_array_kind kind);
+struct h_array* h_array_from_values(struct h_arena* arena, struct h_value_stack* values);
+struct h_array* h_array_from_bytes(struct h_arena* arena, const char* bytes, size_t count);
+struct h_array* h_array_create_view(struct h_arena* arena, struct h_array* base, size_t offset, size_t count,
+		size_t stride);
+struct h_array* h_array_mutable(struct h_value* value);
+void h_array_free(struct h_array* array);
+
+size_t h_array_count(const struct h_array* array);
+struct h_value h_array_get(const struct h_array* array, size_t index);
+void h_array_set(struct h_array* array, size_t index, struct h_value value);
+void h_array_reserve(struct h_array* array, size_t count);
+void h_array_push(struct h_array* array, struct h_value value);
+struct h_value h_array_pop(struct h_array* array);
+void h_array_append(struct h_array* array, const struct h_array* tail);
+const void* h_array_data(const struct h_array* array, enum h_array_kind* kind, size_t* stride);
+bool h_array_is_string(const struct h_array* array);
+
+struct h_function* h_function_create(struct h_arena* arena, struct h_program* program, size_t offset,
+		size_t count);
+
+struct h_program* h_program_create(struct h_arena* arena);
+void h_program_retain(struct h_program* program);
+void h_program_release(struct h_program* program);
+void h_optimize(struct h_instr_stack* instr_stack);
+struct h_program* h_compile(const struct h_instr_stack* instr_stack);
+struct h_source h_program_source(const struct h_program* program, size_t offset);
+void h_program_link(struct h_program* program);
+size_t h_op_operands(enum h_instr_type type);
+enum h_instr_type h_op_generic(enum h_instr_type type);
+struct h_error h_verify_program(struct h_program* program);
+
+uint32_t h_intern(const char* name);
+bool h_find_symbol(const char* name, uint32_t* slot);
+
+void h_tree_retain(struct h_tree_node* node);
+void h_tree_release(struct h_tree_node* node);
+size_t h_tree_count(const struct h_tree_node* node);
+struct h_value h_tree_get(const struct h_tree_node* node, size_t index);
+struct h_tree_node* h_tree_set(struct h_arena* arena, struct h_tree_node* node, size_t index,
+		struct h_value value);
+struct h_tree_node* h_tree_push(struct h_arena* arena, struct h_tree_node* node, struct h_value value);
+struct h_tree_node* h_tree_pop(struct h_arena* arena, struct h_tree_node* node, struct h_value* value);
+struct h_tree_node* h_tree_cat(struct h_arena* arena, struct h_tree_node* left, struct h_tree_node* right);
+
+void h_bignum_retain(struct h_bignum* bignum);
+void h_bignum_release(struct h_bignum* bignum);
+struct h_bignum* h_bignum_from_integer(int64_t integer);
+struct h_bignum* h_bignum_from_limbs(bool negative, const uint32_t* limbs, size_t count);
+bool h_bignum_to_integer(const struct h_bignum* bignum, int64_t* integer);
+int h_bignum_compare(const struct h_bignum* a, const struct h_bignum* b);
+struct h_bignum* h_bignum_add(const struct h_bignum* a, const struct h_bignum* b);
+struct h_bignum* h_bignum_sub(const struct h_bignum* a, const struct h_bignum* b);
+struct h_bignum* h_bignum_mul(const struct h_bignum* a, const struct h_bignum* b);
+struct h_bignum* h_bignum_divide_small(const struct h_bignum* bignum, uint32_t divisor, uint32_t* remainder);
+size_t h_bignum_to_string(const struct h_bignum* bignum, char* buf, size_t buf_size);
+
+struct h_value h_number_add(const struct h_value* value0, const struct h_value* value1);
+struct h_value h_number_sub(const struct h_value* value0, const struct h_value* value1);
+struct h_value h_number_mul(const struct h_value* value0, const struct h_value* value1);
+struct h_value h_number_div(const struct h_value* value0, const struct h_value* value1);
+struct h_value h_number_pow(const struct h_value* base, const struct h_value* exponent);
+bool h_number_equals(const struct h_value* value0, const struct h_value* value1);
+int h_number_compare(const struct h_value* value0, const struct h_value* value1);
+bool h_number_is_true(const struct h_value* value);
+
+void h_value_retain(const struct h_value* value);
+void h_value_release(struct h_value* value);
 
 void h_value_stack_free_value(struct h_value* value);
 void h_value_stack_free(struct h_value_stack* stack);
 
+void h_instr_stack_reserve(struct h_instr_stack* stack, size_t count);
 void h_instr_stack_push(struct h_instr_stack* stack, const struct h_instr* data);
 void h_instr_stack_drop(struct h_instr_stack* stack);
 struct h_instr* h_instr_stack_peek(const struct h_instr_stack* stack);
@@ -305,15 +927,44 @@ struct h_instr h_instr_stack_pop(struct h_instr_stack* stack);
 void h_instr_stack_free_instr(struct h_instr* instr);
 void h_instr_stack_free(struct h_instr_stack* stack);
 
-void h_sumboil_stack_push(struct h_sumboil_stack* stack, const struct h_sumboil* data);
-void h_sumboil_stack_drop(struct h_sumboil_stack* stack);
-struct h_sumboil* h_sumboil_stack_peek(const struct h_sumboil_stack* stack);
-struct h_sumboil h_sumboil_stack_pop(struct h_sumboil_stack* stack);
+void h_op_stack_push(struct h_op_stack* stack, const struct h_op* data);
+void h_line_stack_push(struct h_line_stack* stack, const struct h_line* data);
+
+void h_symbol_stack_push(struct h_symbol_stack* stack, const char* name);
+void h_symbol_stack_free(struct h_symbol_stack* stack);
 
+struct h_value* h_sumboil_stack_get(const struct h_sumboil_stack* stack, uint32_t slot);
+void h_sumboil_stack_set(struct h_sumboil_stack* stack, uint32_t slot, struct h_value value);
+
+void h_sumboil_stack_reserve_caches(struct h_sumboil_stack* stack, size_t count);
 void h_sumboil_stack_free_sumboil(struct h_sumboil* sumboil);
 void h_sumboil_stack_free(struct h_sumboil_stack* stack);
 
+void h_create_runtime(struct h_runtime* runtime, struct h_arena* arena);
+void h_free_runtime(struct h_runtime* runtime);
+struct h_value* h_runtime_lookup(const struct h_runtime* runtime, const char* name);
+void h_runtime_define(struct h_runtime* runtime, const char* name, struct h_value value);
+
 struct h_error h_execute_instr_stack(const struct h_instr_stack* instr_stack, struct h_runtime* runtime);
+struct h_error h_execute_program(const struct h_program* program, struct h_runtime* runtime);
+struct h_error h_execute_function(const struct h_function* function, struct h_runtime* runtime);
+
+bool h_translate_registers(const struct h_function* function, size_t arguments, struct h_register_code* code);
+void h_optimize_registers(struct h_register_code* code, unsigned level);
+bool h_prepare_registers(struct h_register_code* code, struct h_runtime* runtime);
+struct h_error h_execute_registers(struct h_register_code* code, const struct h_value* arguments,
+		struct h_value* result);
+void h_release_registers(struct h_register_code* code);
+
+struct h_native* h_jit_compile(const struct h_register_code* code);
+void h_jit_free(struct h_native* native);
+const struct h_native* h_jit_lookup(const struct h_function* body, const struct h_register_code* code,
+		size_t iterations);
+void h_jit_release(struct h_program* program);
+
+#ifdef H_PROFILE_OPS
+void h_write_op_profile(FILE* stream, size_t limit);
+#endif
 
 struct h_error h_parse_code(struct h_instr_stack* instr_stack, const char* text);
 
@@ -323,11 +974,12 @@ void h_free_lexer(struct h_lexer* lexer);
 
 void h_create_error_message(const struct h_error* error, char* buf, size_t buf_len);
 
-void h_value_to_string_buf(const struct h_value* value, char* buf, size_t buf_size);
-void h_value_stack_to_string_buf(const struct h_value_stack* stack, char* buf, size_t buf_size);
+size_t h_value_to_string_buf(const struct h_value* value, char* buf, size_t buf_size);
+size_t h_value_stack_to_string_buf(const struct h_value_stack* stack, char* buf, size_t buf_size);
+char* h_value_stack_to_string(const struct h_value_stack* stack);
 bool h_is_array_string(const struct h_value_stack* stack);
 
-struct h_error h_read_bytecode(FILE* file, struct h_instr_stack* stack);
-void h_write_bytecode(FILE* file, const struct h_instr_stack* stack);
+struct h_error h_read_bytecode(FILE* file, struct h_program* program);
+void h_write_bytecode(FILE* file, const struct h_program* program);
 
 #endif
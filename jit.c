@@ -0,0 +1,413 @@
+/*
+	Permission to use, copy, modify, and/or distribute this software for
+	any purpose with or without fee is hereby granted.
+
+	THE SOFTWARE IS PROVIDED “AS IS” AND THE AUTHOR DISCLAIMS ALL
+	WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+	FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+	DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+	AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "h.h"
+
+#define MAX_CODE_SIZE 8192
+
+#define RAX 0
+#define RCX 1
+#define RDX 2
+
+#define CONDITION_OVERFLOW      0x0
+#define CONDITION_EQUAL         0x4
+#define CONDITION_NOT_EQUAL     0x5
+#define CONDITION_LESS          0xc
+#define CONDITION_MORE_OR_EQUAL 0xd
+#define CONDITION_LESS_OR_EQUAL 0xe
+#define CONDITION_MORE          0xf
+
+struct assembler {
+	uint8_t code[MAX_CODE_SIZE];
+	size_t size;
+	bool overflow;
+};
+
+static void emit_bytes(struct assembler* assembler, const void* bytes, size_t count)
+{
+	if (assembler->size + count > MAX_CODE_SIZE) {
+		assembler->overflow = true;
+		return;
+	}
+
+	memcpy(assembler->code + assembler->size, bytes, count);
+	assembler->size += count;
+}
+
+#define emit(assembler, ...) \
+	emit_bytes(assembler, (const uint8_t[]) { __VA_ARGS__ }, sizeof((const uint8_t[]) { __VA_ARGS__ }))
+
+static void emit_u32(struct assembler* assembler, uint32_t value)
+{
+	emit_bytes(assembler, &value, sizeof(value));
+}
+
+static void emit_u64(struct assembler* assembler, uint64_t value)
+{
+	emit_bytes(assembler, &value, sizeof(value));
+}
+
+static uint32_t displacement(uint8_t index, size_t field)
+{
+	return index * sizeof(struct h_value) + field;
+}
+
+static void emit_load(struct assembler* assembler, int reg, uint8_t index)
+{
+	emit(assembler, 0x48, 0x8b, 0x87 | reg << 3);
+	emit_u32(assembler, displacement(index, offsetof(struct h_value, value.integer)));
+}
+
+static void emit_store(struct assembler* assembler, uint8_t index, int reg)
+{
+	emit(assembler, 0x48, 0x89, 0x87 | reg << 3);
+	emit_u32(assembler, displacement(index, offsetof(struct h_value, value.integer)));
+}
+
+static void emit_move_immediate(struct assembler* assembler, int reg, uint64_t value)
+{
+	emit(assembler, 0x48, 0xb8 + reg);
+	emit_u64(assembler, value);
+}
+
+static void emit_fail_if(struct assembler* assembler, int condition)
+{
+	emit(assembler, 0x0f, 0x80 | condition);
+	emit_u32(assembler, -(int32_t) (assembler->size + 4));
+}
+
+#ifdef H_COMPACT_VALUES
+static void emit_guard(struct assembler* assembler, uint8_t index)
+{
+	emit(assembler, 0x48, 0x8b, 0x87);
+	emit_u32(assembler, displacement(index, offsetof(struct h_value, box.tag)));
+	emit_move_immediate(assembler, RDX, H_VALUE_TAG_INTEGER);
+	emit(assembler, 0x48, 0x39, 0xd0);
+	emit_fail_if(assembler, CONDITION_NOT_EQUAL);
+}
+
+static void emit_tag(struct assembler* assembler, uint8_t index)
+{
+	emit_move_immediate(assembler, RDX, H_VALUE_TAG_INTEGER);
+	emit(assembler, 0x48, 0x89, 0x97);
+	emit_u32(assembler, displacement(index, offsetof(struct h_value, box.tag)));
+}
+#else
+static void emit_guard(struct assembler* assembler, uint8_t index)
+{
+	emit(assembler, 0x81, 0xbf);
+	emit_u32(assembler, displacement(index, offsetof(struct h_value, type)));
+	emit_u32(assembler, H_NUMBER);
+	emit_fail_if(assembler, CONDITION_NOT_EQUAL);
+
+	emit(assembler, 0x81, 0xbf);
+	emit_u32(assembler, displacement(index, offsetof(struct h_value, number_kind)));
+	emit_u32(assembler, H_NUMBER_INTEGER);
+	emit_fail_if(assembler, CONDITION_NOT_EQUAL);
+}
+
+static void emit_tag(struct assembler* assembler, uint8_t index)
+{
+	emit(assembler, 0xc7, 0x87);
+	emit_u32(assembler, displacement(index, offsetof(struct h_value, type)));
+	emit_u32(assembler, H_NUMBER);
+
+	emit(assembler, 0xc7, 0x87);
+	emit_u32(assembler, displacement(index, offsetof(struct h_value, number_kind)));
+	emit_u32(assembler, H_NUMBER_INTEGER);
+}
+#endif
+
+static void emit_range_check(struct assembler* assembler)
+{
+	emit_move_immediate(assembler, RDX, H_MAX_EXACT_INTEGER);
+	emit(assembler, 0x48, 0x39, 0xd0);
+	emit_fail_if(assembler, CONDITION_MORE);
+	emit(assembler, 0x48, 0xf7, 0xda);
+	emit(assembler, 0x48, 0x39, 0xd0);
+	emit_fail_if(assembler, CONDITION_LESS);
+}
+
+static void emit_compare(struct assembler* assembler, int condition)
+{
+	emit(assembler, 0x48, 0x39, 0xc8);
+	emit(assembler, 0x0f, 0x90 | condition, 0xc0);
+	emit(assembler, 0x0f, 0xb6, 0xc0);
+}
+
+static bool is_binary_op(enum h_instr_type type)
+{
+	switch (type) {
+	case H_ADD:
+	case H_SUB:
+	case H_MUL:
+	case H_DIV:
+	case H_EQUALS:
+	case H_NOT_EQUALS:
+	case H_MORE:
+	case H_LESS:
+	case H_MORE_OR_EQUALS:
+	case H_LESS_OR_EQUALS:
+	case H_AND:
+	case H_OR:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+static bool emit_op(struct assembler* assembler, const struct h_register_op* op)
+{
+	emit_load(assembler, RAX, op->source0);
+
+	if (is_binary_op(op->type))
+		emit_load(assembler, RCX, op->source1);
+
+	switch (op->type) {
+	case H_ADD:
+		emit(assembler, 0x48, 0x01, 0xc8);
+		emit_range_check(assembler);
+		break;
+
+	case H_SUB:
+		emit(assembler, 0x48, 0x29, 0xc8);
+		emit_range_check(assembler);
+		break;
+
+	case H_MUL:
+		emit(assembler, 0x48, 0x0f, 0xaf, 0xc1);
+		emit_fail_if(assembler, CONDITION_OVERFLOW);
+		emit(assembler, 0x48, 0x85, 0xc0);
+		emit_fail_if(assembler, CONDITION_EQUAL);
+		emit_range_check(assembler);
+		break;
+
+	case H_DIV:
+		emit(assembler, 0x48, 0x85, 0xc9);
+		emit_fail_if(assembler, CONDITION_EQUAL);
+		emit(assembler, 0x48, 0x83, 0xf9, 0xff);
+		emit_fail_if(assembler, CONDITION_EQUAL);
+		emit(assembler, 0x48, 0x85, 0xc0);
+		emit_fail_if(assembler, CONDITION_EQUAL);
+		emit(assembler, 0x48, 0x99);
+		emit(assembler, 0x48, 0xf7, 0xf9);
+		emit(assembler, 0x48, 0x85, 0xd2);
+		emit_fail_if(assembler, CONDITION_NOT_EQUAL);
+		break;
+
+	case H_EQUALS: emit_compare(assembler, CONDITION_EQUAL); break;
+	case H_NOT_EQUALS: emit_compare(assembler, CONDITION_NOT_EQUAL); break;
+	case H_MORE: emit_compare(assembler, CONDITION_MORE); break;
+	case H_LESS: emit_compare(assembler, CONDITION_LESS); break;
+	case H_MORE_OR_EQUALS: emit_compare(assembler, CONDITION_MORE_OR_EQUAL); break;
+	case H_LESS_OR_EQUALS: emit_compare(assembler, CONDITION_LESS_OR_EQUAL); break;
+
+	case H_AND:
+		emit(assembler, 0x48, 0x85, 0xc0, 0x0f, 0x95, 0xc0);
+		emit(assembler, 0x48, 0x85, 0xc9, 0x0f, 0x95, 0xc1);
+		emit(assembler, 0x20, 0xc8, 0x0f, 0xb6, 0xc0);
+		break;
+
+	case H_OR:
+		emit(assembler, 0x48, 0x09, 0xc8, 0x0f, 0x95, 0xc0, 0x0f, 0xb6, 0xc0);
+		break;
+
+	case H_NOT:
+		emit(assembler, 0x48, 0x85, 0xc0, 0x0f, 0x94, 0xc0, 0x0f, 0xb6, 0xc0);
+		break;
+
+	case H_REAL:
+		break;
+
+	case H_IMAG:
+		emit(assembler, 0x31, 0xc0);
+		break;
+
+	default:
+		return false;
+	}
+
+	emit_store(assembler, op->target, RAX);
+	emit_tag(assembler, op->target);
+
+	return true;
+}
+
+static void guard(struct assembler* assembler, bool* known, uint8_t index)
+{
+	if (known[index])
+		return;
+
+	emit_guard(assembler, index);
+	known[index] = true;
+}
+
+static bool assemble(struct assembler* assembler, const struct h_register_code* code)
+{
+	bool known[H_MAX_REGISTERS] = {0};
+
+	emit(assembler, 0x31, 0xc0, 0xc3);
+
+	for (size_t i = code->invariants; i < code->count; i++) {
+		const struct h_register_op* op = &code->ops[i];
+
+		guard(assembler, known, op->source0);
+
+		if (is_binary_op(op->type))
+			guard(assembler, known, op->source1);
+
+		known[op->target] = true;
+	}
+
+	guard(assembler, known, code->result);
+
+	for (size_t i = code->invariants; i < code->count; i++)
+		if (!emit_op(assembler, &code->ops[i]))
+			return false;
+
+	emit(assembler, 0xb8, 0x01, 0x00, 0x00, 0x00, 0xc3);
+
+	return !assembler->overflow;
+}
+
+struct h_native* h_jit_compile(const struct h_register_code* code)
+{
+#ifdef __x86_64__
+	struct assembler assembler = {0};
+
+	if (!assemble(&assembler, code))
+		return NULL;
+
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t size = (assembler.size + page - 1) / page * page;
+	void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (memory == MAP_FAILED)
+		return NULL;
+
+	memcpy(memory, assembler.code, assembler.size);
+
+	if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+		munmap(memory, size);
+		return NULL;
+	}
+
+	struct h_native* native = malloc(sizeof(struct h_native));
+
+	*native = (struct h_native) {
+		.entry      = (bool (*)(struct h_value*)) ((uint8_t*) memory + 3),
+		.memory     = memory,
+		.size       = size,
+		.count      = code->count,
+		.invariants = code->invariants,
+		.arguments  = code->arguments,
+		.result     = code->result,
+	};
+
+	memcpy(native->ops, code->ops, code->count * sizeof(struct h_register_op));
+
+	return native;
+#else
+	return NULL;
+#endif
+}
+
+void h_jit_free(struct h_native* native)
+{
+	if (native == NULL)
+		return;
+
+	munmap(native->memory, native->size);
+	free(native);
+}
+
+static bool is_compiled_from(const struct h_native* native, const struct h_register_code* code)
+{
+	return native->count == code->count && native->invariants == code->invariants
+		&& native->arguments == code->arguments && native->result == code->result
+		&& memcmp(native->ops, code->ops, code->count * sizeof(struct h_register_op)) == 0;
+}
+
+static void write_perf_map(const struct h_native* native, const struct h_program* program, size_t offset)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int) getpid());
+
+	FILE* file = fopen(path, "a");
+
+	if (file == NULL)
+		return;
+
+	struct h_source source = h_program_source(program, offset);
+
+	if (source.source_type == H_ERROR_SOURCE_TEXT_FILE)
+		fprintf(file, "%lx %zx h_body:%zu:%zu\n", (unsigned long) native->memory, native->size,
+				source.source.text_source.code_pos.line, source.source.text_source.code_pos.line_pos);
+	else
+		fprintf(file, "%lx %zx h_body@%zu\n", (unsigned long) native->memory, native->size, offset);
+
+	fclose(file);
+}
+
+const struct h_native* h_jit_lookup(const struct h_function* body, const struct h_register_code* code,
+		size_t iterations)
+{
+	struct h_jit_site* site = &body->program->jit_sites[body->offset];
+	struct h_native* native = __atomic_load_n(&site->native, __ATOMIC_ACQUIRE);
+
+	if (native != NULL)
+		return is_compiled_from(native, code) ? native : NULL;
+
+	if (__atomic_add_fetch(&site->heat, iterations, __ATOMIC_RELAXED) < H_JIT_THRESHOLD
+			|| __atomic_load_n(&site->rejected, __ATOMIC_RELAXED))
+		return NULL;
+
+	if ((native = h_jit_compile(code)) == NULL) {
+		__atomic_store_n(&site->rejected, true, __ATOMIC_RELAXED);
+		return NULL;
+	}
+
+	struct h_native* expected = NULL;
+
+	if (!__atomic_compare_exchange_n(&site->native, &expected, native, false, __ATOMIC_ACQ_REL,
+				__ATOMIC_ACQUIRE)) {
+		h_jit_free(native);
+
+		return is_compiled_from(expected, code) ? expected : NULL;
+	}
+
+	write_perf_map(native, body->program, body->offset);
+
+	return native;
+}
+
+void h_jit_release(struct h_program* program)
+{
+	if (program->jit_sites == NULL)
+		return;
+
+	for (size_t i = 0; i < program->code.count; i++)
+		h_jit_free(program->jit_sites[i].native);
+
+	if (program->arena == NULL)
+		free(program->jit_sites);
+}
@@ -417,6 +417,21 @@ static struct h_error parse_tok(const char* text, struct h_lexer_tok* tok)
 		return_ok();
 	}
 
+	if (strcmp(text, "~^") == 0) {
+		tok->type = H_TOK_ARR_TAKE;
+		return_ok();
+	}
+
+	if (strcmp(text, "~_") == 0) {
+		tok->type = H_TOK_ARR_DROP;
+		return_ok();
+	}
+
+	if (strcmp(text, "~%") == 0) {
+		tok->type = H_TOK_ARR_STEP;
+		return_ok();
+	}
+
 	if (strcmp(text, "==") == 0) {
 		tok->type = H_TOK_EQUALS;
 		return_ok();
@@ -0,0 +1,313 @@
+/*
+	Permission to use, copy, modify, and/or distribute this software for
+	any purpose with or without fee is hereby granted.
+
+	THE SOFTWARE IS PROVIDED “AS IS” AND THE AUTHOR DISCLAIMS ALL
+	WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+	FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+	DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+	AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <math.h>
+
+#include "h.h"
+
+#define is_exact(x) ((x) >= -H_MAX_EXACT_INTEGER && (x) <= H_MAX_EXACT_INTEGER)
+
+#define MAX_EXACT_POW_BITS (1 << 24)
+
+static bool both_integers(const struct h_value* value0, const struct h_value* value1)
+{
+	return h_value_get_number_kind(value0) == H_NUMBER_INTEGER
+		&& h_value_get_number_kind(value1) == H_NUMBER_INTEGER;
+}
+
+static bool is_exact_kind(const struct h_value* value)
+{
+	return h_value_get_number_kind(value) == H_NUMBER_INTEGER || h_value_get_number_kind(value) == H_NUMBER_BIG;
+}
+
+static bool both_exact(const struct h_value* value0, const struct h_value* value1)
+{
+	return is_exact_kind(value0) && is_exact_kind(value1);
+}
+
+static bool both_real(const struct h_value* value0, const struct h_value* value1)
+{
+	return h_value_get_number_kind(value0) != H_NUMBER_COMPLEX
+		&& h_value_get_number_kind(value1) != H_NUMBER_COMPLEX;
+}
+
+static struct h_bignum* to_bignum(const struct h_value* value)
+{
+	if (h_value_get_number_kind(value) == H_NUMBER_INTEGER)
+		return h_bignum_from_integer(h_value_get_integer(value));
+
+	h_bignum_retain(h_value_get_bignum(value));
+
+	return h_value_get_bignum(value);
+}
+
+static struct h_value make_bignum(struct h_bignum* bignum)
+{
+	int64_t integer;
+
+	if (!h_bignum_to_integer(bignum, &integer))
+		return h_make_bignum(bignum);
+
+	h_bignum_release(bignum);
+
+	return h_make_integer(integer);
+}
+
+static struct h_value make_exact(int64_t integer)
+{
+	return is_exact(integer) ? h_make_integer(integer) : h_make_bignum(h_bignum_from_integer(integer));
+}
+
+static struct h_value bignum_op(const struct h_value* value0, const struct h_value* value1,
+		struct h_bignum* (*op)(const struct h_bignum*, const struct h_bignum*))
+{
+	struct h_bignum* bignum0 = to_bignum(value0);
+	struct h_bignum* bignum1 = to_bignum(value1);
+	struct h_bignum* result  = op(bignum0, bignum1);
+
+	h_bignum_release(bignum0);
+	h_bignum_release(bignum1);
+
+	return make_bignum(result);
+}
+
+struct h_value h_number_add(const struct h_value* value0, const struct h_value* value1)
+{
+	if (both_integers(value0, value1))
+		return make_exact(h_value_get_integer(value0) + h_value_get_integer(value1));
+
+	if (both_exact(value0, value1))
+		return bignum_op(value0, value1, h_bignum_add);
+
+	if (both_real(value0, value1))
+		return h_make_real(h_value_get_real(value0) + h_value_get_real(value1));
+
+	return h_make_number(h_value_get_number(value0) + h_value_get_number(value1));
+}
+
+struct h_value h_number_sub(const struct h_value* value0, const struct h_value* value1)
+{
+	if (both_integers(value0, value1))
+		return make_exact(h_value_get_integer(value0) - h_value_get_integer(value1));
+
+	if (both_exact(value0, value1))
+		return bignum_op(value0, value1, h_bignum_sub);
+
+	if (both_real(value0, value1))
+		return h_make_real(h_value_get_real(value0) - h_value_get_real(value1));
+
+	return h_make_number(h_value_get_number(value0) - h_value_get_number(value1));
+}
+
+struct h_value h_number_mul(const struct h_value* value0, const struct h_value* value1)
+{
+	int64_t result;
+
+	if (both_exact(value0, value1) && h_number_is_true(value0) && h_number_is_true(value1)) {
+		if (both_integers(value0, value1) && !__builtin_mul_overflow(h_value_get_integer(value0),
+					h_value_get_integer(value1), &result))
+			return make_exact(result);
+
+		return bignum_op(value0, value1, h_bignum_mul);
+	}
+
+	if (both_exact(value0, value1) && !both_integers(value0, value1))
+		return h_make_integer(0);
+
+	if (both_integers(value0, value1) && h_value_get_integer(value0) >= 0 && h_value_get_integer(value1) >= 0)
+		return h_make_integer(0);
+
+	if (both_real(value0, value1))
+		return h_make_real(h_value_get_real(value0) * h_value_get_real(value1));
+
+	return h_make_number(h_value_get_number(value0) * h_value_get_number(value1));
+}
+
+static bool bignum_div(const struct h_value* value0, const struct h_value* value1, struct h_value* result)
+{
+	if (h_value_get_number_kind(value0) != H_NUMBER_BIG || h_value_get_number_kind(value1) != H_NUMBER_INTEGER)
+		return false;
+
+	int64_t divisor = h_value_get_integer(value1);
+	uint64_t magnitude = divisor < 0 ? -(uint64_t) divisor : (uint64_t) divisor;
+	uint32_t remainder;
+
+	if (magnitude == 0 || magnitude > UINT32_MAX)
+		return false;
+
+	struct h_bignum* quotient = h_bignum_divide_small(h_value_get_bignum(value0), magnitude, &remainder);
+
+	if (remainder != 0) {
+		h_bignum_release(quotient);
+		return false;
+	}
+
+	if (divisor < 0)
+		quotient->negative = !quotient->negative;
+
+	*result = make_bignum(quotient);
+
+	return true;
+}
+
+struct h_value h_number_div(const struct h_value* value0, const struct h_value* value1)
+{
+	struct h_value result;
+
+	if (both_integers(value0, value1)) {
+		int64_t dividend = h_value_get_integer(value0);
+		int64_t divisor  = h_value_get_integer(value1);
+
+		if (divisor != 0 && dividend % divisor == 0 && (dividend != 0 || divisor > 0))
+			return h_make_integer(dividend / divisor);
+	}
+
+	if (bignum_div(value0, value1, &result))
+		return result;
+
+	if (both_real(value0, value1))
+		return h_make_real(h_value_get_real(value0) / h_value_get_real(value1));
+
+	return h_make_number(h_value_get_number(value0) / h_value_get_number(value1));
+}
+
+static bool integer_pow(int64_t base, int64_t exponent, int64_t* result)
+{
+	int64_t power = 1;
+
+	while (exponent > 0) {
+		if ((exponent & 1) && (__builtin_mul_overflow(power, base, &power) || !is_exact(power)))
+			return false;
+
+		exponent >>= 1;
+
+		if (exponent > 0 && (__builtin_mul_overflow(base, base, &base) || !is_exact(base)))
+			return false;
+	}
+
+	*result = power;
+
+	return true;
+}
+
+static size_t bit_count(const struct h_value* value)
+{
+	if (h_value_get_number_kind(value) == H_NUMBER_BIG)
+		return h_value_get_bignum(value)->count * 32;
+
+	int64_t integer = h_value_get_integer(value);
+
+	return integer == 0 ? 0 : 64 - __builtin_clzll(integer < 0 ? -(uint64_t) integer : (uint64_t) integer);
+}
+
+static struct h_value bignum_pow(const struct h_value* base, int64_t exponent)
+{
+	struct h_bignum* power  = h_bignum_from_integer(1);
+	struct h_bignum* square = to_bignum(base);
+	struct h_bignum* next;
+
+	while (exponent > 0) {
+		if (exponent & 1) {
+			next = h_bignum_mul(power, square);
+			h_bignum_release(power);
+			power = next;
+		}
+
+		exponent >>= 1;
+
+		if (exponent > 0) {
+			next = h_bignum_mul(square, square);
+			h_bignum_release(square);
+			square = next;
+		}
+	}
+
+	h_bignum_release(square);
+
+	return make_bignum(power);
+}
+
+struct h_value h_number_pow(const struct h_value* base, const struct h_value* exponent)
+{
+	double real_base     = h_value_get_real(base);
+	double real_exponent = h_value_get_real(exponent);
+
+	if (!both_real(base, exponent) || !(real_base > 0) || !isfinite(real_base) || !isfinite(real_exponent))
+		return h_make_number(cpow(h_value_get_number(base), h_value_get_number(exponent)));
+
+	bool is_integer_exponent = is_exact(real_exponent) && real_exponent == (int64_t) real_exponent;
+	int64_t result;
+
+	if (is_integer_exponent && real_exponent >= 0 && h_value_get_number_kind(base) == H_NUMBER_INTEGER
+			&& integer_pow(h_value_get_integer(base), real_exponent, &result))
+		return h_make_integer(result);
+
+	if (is_integer_exponent && real_exponent >= 0 && is_exact_kind(base)
+			&& bit_count(base) * real_exponent <= MAX_EXACT_POW_BITS)
+		return bignum_pow(base, real_exponent);
+
+	return h_make_real(pow(real_base, real_exponent));
+}
+
+static int compare_exact(const struct h_value* value0, const struct h_value* value1)
+{
+	if (both_integers(value0, value1))
+		return (h_value_get_integer(value0) > h_value_get_integer(value1))
+			- (h_value_get_integer(value0) < h_value_get_integer(value1));
+
+	struct h_bignum* bignum0 = to_bignum(value0);
+	struct h_bignum* bignum1 = to_bignum(value1);
+	int result               = h_bignum_compare(bignum0, bignum1);
+
+	h_bignum_release(bignum0);
+	h_bignum_release(bignum1);
+
+	return result;
+}
+
+bool h_number_equals(const struct h_value* value0, const struct h_value* value1)
+{
+	if (both_exact(value0, value1))
+		return compare_exact(value0, value1) == 0;
+
+	if (both_real(value0, value1))
+		return h_value_get_real(value0) == h_value_get_real(value1);
+
+	return h_value_get_number(value0) == h_value_get_number(value1);
+}
+
+int h_number_compare(const struct h_value* value0, const struct h_value* value1)
+{
+	if (both_exact(value0, value1))
+		return compare_exact(value0, value1);
+
+	double real0 = h_value_get_real(value0);
+	double real1 = h_value_get_real(value1);
+
+	if (real0 != real0 || real1 != real1)
+		return 2;
+
+	return (real0 > real1) - (real0 < real1);
+}
+
+bool h_number_is_true(const struct h_value* value)
+{
+	switch (h_value_get_number_kind(value)) {
+	case H_NUMBER_INTEGER: return h_value_get_integer(value) != 0;
+	case H_NUMBER_REAL: return h_value_get_real(value) != 0;
+	case H_NUMBER_COMPLEX: return h_value_get_number(value) != 0;
+	case H_NUMBER_BIG: return true;
+	}
+
+	return false;
+}
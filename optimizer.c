@@ -0,0 +1,508 @@
+/*
+	Permission to use, copy, modify, and/or distribute this software for
+	any purpose with or without fee is hereby granted.
+
+	THE SOFTWARE IS PROVIDED “AS IS” AND THE AUTHOR DISCLAIMS ALL
+	WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+	FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+	DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+	AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <complex.h>
+#include <math.h>
+#include <string.h>
+
+#include "h.h"
+
+#define MAX_ARITY 2
+#define MAX_FOLDED_ARRAY 1024
+#define MAX_FOLDED_LIMBS 256
+#define MAX_INLINED_SIZE 16
+
+static int arity(const struct h_instr* instr)
+{
+	const struct h_instr_stack* body;
+
+	switch (instr->type) {
+	case H_IMAGINARITY_CONST:
+		return 0;
+
+	case H_REAL:
+	case H_IMAG:
+	case H_POP:
+	case H_COPY:
+	case H_ARR_GET:
+	case H_ARR_POP:
+	case H_ARR_FLIP:
+	case H_ARR_COPY:
+	case H_NOT:
+		return 1;
+
+	case H_ADD:
+	case H_SUB:
+	case H_MUL:
+	case H_DIV:
+	case H_POW:
+	case H_FLIP:
+	case H_ARR_PUSH:
+	case H_ARR_CAT:
+	case H_ARR_TAKE:
+	case H_ARR_DROP:
+	case H_ARR_STEP:
+	case H_EQUALS:
+	case H_NOT_EQUALS:
+	case H_MORE:
+	case H_LESS:
+	case H_MORE_OR_EQUALS:
+	case H_LESS_OR_EQUALS:
+	case H_AND:
+	case H_OR:
+	case H_RANGE:
+		return 2;
+
+	case H_ARRAY_DEF:
+		body = &instr->value.array_def;
+
+		if (body->count > MAX_FOLDED_ARRAY)
+			return -1;
+
+		for (size_t i = 0; i < body->count; i++)
+			if (body->instrs[i].type != H_VALUE)
+				return -1;
+
+		return 0;
+
+	default:
+		return -1;
+	}
+}
+
+static bool is_small(const struct h_value* value)
+{
+	switch (h_value_get_type(value)) {
+	case H_ARRAY:
+		return h_array_count(h_value_get_array(value)) <= MAX_FOLDED_ARRAY;
+
+	case H_NUMBER:
+		return h_value_get_number_kind(value) != H_NUMBER_BIG
+			|| h_value_get_bignum(value)->count <= MAX_FOLDED_LIMBS;
+
+	default:
+		return true;
+	}
+}
+
+static bool is_exact(const struct h_value* value)
+{
+	return h_value_get_type(value) == H_NUMBER && (h_value_get_number_kind(value) == H_NUMBER_INTEGER
+			|| h_value_get_number_kind(value) == H_NUMBER_BIG);
+}
+
+static bool is_cheap(const struct h_instr_stack* folded, const struct h_instr* instr)
+{
+	if (instr->type != H_RANGE && instr->type != H_POW)
+		return true;
+
+	const struct h_value* value0 = &folded->instrs[folded->count - 1].value.value;
+	const struct h_value* value1 = &folded->instrs[folded->count - 2].value.value;
+
+	if (h_value_get_type(value0) != H_NUMBER || h_value_get_type(value1) != H_NUMBER)
+		return false;
+
+	double real0 = creal(h_value_get_number(value0));
+	double real1 = creal(h_value_get_number(value1));
+
+	if (instr->type == H_RANGE)
+		return fabs(real1 - real0) <= MAX_FOLDED_ARRAY;
+
+	return !is_exact(value0) || !is_exact(value1) || fabs(real0) <= MAX_FOLDED_LIMBS;
+}
+
+static bool fold(struct h_instr_stack* folded, size_t* run, struct h_instr* instr)
+{
+	int operands = arity(instr);
+
+	if (operands < 0 || (size_t) operands > *run || !is_cheap(folded, instr))
+		return false;
+
+	struct h_instr scratch[MAX_ARITY + 1];
+	struct h_instr_stack code = { .instrs = scratch, .count = operands + 1, .arena = folded->arena };
+
+	for (int i = 0; i < operands; i++) {
+		scratch[i] = folded->instrs[folded->count - operands + i];
+		h_value_retain(&scratch[i].value.value);
+	}
+
+	scratch[operands] = *instr;
+
+	struct h_runtime runtime;
+	h_create_runtime(&runtime, folded->arena);
+
+	struct h_error error = h_execute_instr_stack(&code, &runtime);
+
+	for (int i = 0; i < operands; i++)
+		h_value_release(&scratch[i].value.value);
+
+	bool is_foldable = error.type == H_OK;
+	for (size_t i = 0; i < runtime.value_stack.count && is_foldable; i++)
+		is_foldable = is_small(&runtime.value_stack.value[i]);
+
+	if (!is_foldable) {
+		h_free_runtime(&runtime);
+		return false;
+	}
+
+	for (int i = 0; i < operands; i++)
+		h_instr_stack_free_instr(&folded->instrs[--folded->count]);
+
+	for (size_t i = 0; i < runtime.value_stack.count; i++) {
+		struct h_instr value = {
+			.type        = H_VALUE,
+			.source      = instr->source,
+			.value.value = runtime.value_stack.value[i],
+		};
+
+		h_instr_stack_push(folded, &value);
+	}
+
+	*run += runtime.value_stack.count - operands;
+
+	runtime.value_stack.count = 0;
+	h_free_runtime(&runtime);
+
+	h_instr_stack_free_instr(instr);
+
+	return true;
+}
+
+static void fold_constants(struct h_instr_stack* instr_stack)
+{
+	struct h_instr_stack folded = { .arena = instr_stack->arena, .root_stack = instr_stack->root_stack };
+	size_t run                  = 0;
+
+	for (size_t i = 0; i < instr_stack->count; i++) {
+		struct h_instr* instr = &instr_stack->instrs[i];
+
+		if (instr->type == H_ARRAY_DEF)
+			fold_constants(&instr->value.array_def);
+
+		if (instr->type == H_FUNCTION_DEF)
+			fold_constants(&instr->value.function_def);
+
+		if (fold(&folded, &run, instr))
+			continue;
+
+		h_instr_stack_push(&folded, instr);
+		run = instr->type == H_VALUE ? run + 1 : 0;
+	}
+
+	if (instr_stack->arena == NULL)
+		free(instr_stack->instrs);
+
+	*instr_stack = folded;
+}
+
+static void count_bindings(const struct h_instr_stack* instr_stack, struct h_base_stack* bindings)
+{
+	for (size_t i = 0; i < instr_stack->count; i++) {
+		const struct h_instr* instr = &instr_stack->instrs[i];
+
+		switch (instr->type) {
+		case H_ARRAY_DEF:
+			count_bindings(&instr->value.array_def, bindings);
+			break;
+
+		case H_FUNCTION_DEF:
+			count_bindings(&instr->value.function_def, bindings);
+			break;
+
+		case H_CREATE_VARIABLE: {
+			uint32_t slot = h_intern(instr->value.sumboil);
+
+			if (slot >= bindings->count) {
+				h_base_stack_reserve(bindings, slot + 1 - bindings->count, sizeof(size_t));
+				memset((size_t*) bindings->ptr + bindings->count, 0,
+						(slot + 1 - bindings->count) * sizeof(size_t));
+
+				bindings->count = slot + 1;
+			}
+
+			((size_t*) bindings->ptr)[slot]++;
+
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+}
+
+static bool can_inline(const struct h_instr_stack* body, const char* name, size_t* size)
+{
+	for (size_t i = 0; i < body->count; i++) {
+		const struct h_instr* instr = &body->instrs[i];
+
+		if (++*size > MAX_INLINED_SIZE)
+			return false;
+
+		switch (instr->type) {
+		case H_ARRAY_DEF:
+			if (!can_inline(&instr->value.array_def, name, size))
+				return false;
+
+			break;
+
+		case H_FUNCTION_DEF:
+			if (!can_inline(&instr->value.function_def, name, size))
+				return false;
+
+			break;
+
+		case H_CREATE_VARIABLE:
+			return false;
+
+		case H_CALL_SUMBOIL:
+			if (strcmp(instr->value.sumboil, name) == 0)
+				return false;
+
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	return true;
+}
+
+static struct h_instr_stack clone_instrs(const struct h_instr_stack* instr_stack, struct h_arena* arena);
+
+static struct h_instr clone_instr(const struct h_instr* instr, struct h_arena* arena)
+{
+	struct h_instr clone = *instr;
+
+	switch (instr->type) {
+	case H_VALUE:
+		h_value_retain(&clone.value.value);
+		break;
+
+	case H_ARRAY_DEF:
+		clone.value.array_def = clone_instrs(&instr->value.array_def, arena);
+		break;
+
+	case H_FUNCTION_DEF:
+		clone.value.function_def = clone_instrs(&instr->value.function_def, arena);
+		break;
+
+	default:
+		break;
+	}
+
+	return clone;
+}
+
+static struct h_instr_stack clone_instrs(const struct h_instr_stack* instr_stack, struct h_arena* arena)
+{
+	struct h_instr_stack clone = { .arena = arena };
+
+	for (size_t i = 0; i < instr_stack->count; i++) {
+		struct h_instr instr = clone_instr(&instr_stack->instrs[i], arena);
+		h_instr_stack_push(&clone, &instr);
+	}
+
+	return clone;
+}
+
+static void substitute(struct h_instr_stack* instr_stack, struct h_instr** known, size_t count);
+
+static void substitute_instr(struct h_instr_stack* substituted, struct h_instr* instr, struct h_instr** known,
+		size_t count)
+{
+	uint32_t slot;
+
+	if (instr->type == H_ARRAY_DEF)
+		substitute(&instr->value.array_def, known, count);
+
+	if (instr->type == H_FUNCTION_DEF)
+		substitute(&instr->value.function_def, known, count);
+
+	if (instr->type != H_CALL_SUMBOIL || !h_find_symbol(instr->value.sumboil, &slot) || slot >= count
+			|| known[slot] == NULL) {
+		h_instr_stack_push(substituted, instr);
+		return;
+	}
+
+	const struct h_instr* binding = known[slot];
+
+	if (binding->type == H_VALUE) {
+		struct h_instr value = clone_instr(binding, substituted->arena);
+		value.source         = instr->source;
+
+		h_instr_stack_push(substituted, &value);
+		return;
+	}
+
+	for (size_t i = 0; i < binding->value.function_def.count; i++) {
+		struct h_instr body_instr = clone_instr(&binding->value.function_def.instrs[i], substituted->arena);
+		h_instr_stack_push(substituted, &body_instr);
+	}
+}
+
+static void substitute(struct h_instr_stack* instr_stack, struct h_instr** known, size_t count)
+{
+	struct h_instr_stack substituted = { .arena = instr_stack->arena, .root_stack = instr_stack->root_stack };
+
+	for (size_t i = 0; i < instr_stack->count; i++)
+		substitute_instr(&substituted, &instr_stack->instrs[i], known, count);
+
+	if (instr_stack->arena == NULL)
+		free(instr_stack->instrs);
+
+	*instr_stack = substituted;
+}
+
+static bool is_propagatable(const struct h_instr* instr, const char* name)
+{
+	size_t size = 0;
+
+	return instr->type == H_VALUE || (instr->type == H_FUNCTION_DEF
+			&& can_inline(&instr->value.function_def, name, &size));
+}
+
+static void propagate_bindings(struct h_instr_stack* instr_stack)
+{
+	struct h_base_stack bindings = {0};
+
+	count_bindings(instr_stack, &bindings);
+
+	struct h_instr** known          = calloc(bindings.count, sizeof(struct h_instr*));
+	struct h_instr_stack propagated = { .arena = instr_stack->arena, .root_stack = instr_stack->root_stack };
+
+	for (size_t i = 0; i < instr_stack->count; i++) {
+		struct h_instr* instr = &instr_stack->instrs[i];
+
+		substitute_instr(&propagated, instr, known, bindings.count);
+
+		if (instr->type != H_CREATE_VARIABLE || propagated.count < 2)
+			continue;
+
+		const struct h_instr* value = &propagated.instrs[propagated.count - 2];
+		uint32_t slot               = h_intern(instr->value.sumboil);
+
+		if (((size_t*) bindings.ptr)[slot] != 1 || !is_propagatable(value, instr->value.sumboil))
+			continue;
+
+		known[slot]  = malloc(sizeof(struct h_instr));
+		*known[slot] = clone_instr(value, instr_stack->arena);
+	}
+
+	for (size_t i = 0; i < bindings.count; i++) {
+		if (known[i] == NULL)
+			continue;
+
+		h_instr_stack_free_instr(known[i]);
+		free(known[i]);
+	}
+
+	if (instr_stack->arena == NULL)
+		free(instr_stack->instrs);
+
+	free(bindings.ptr);
+	free(known);
+
+	*instr_stack = propagated;
+}
+
+static size_t next_depth(const struct h_instr* instr, size_t depth)
+{
+	int operands;
+
+	switch (instr->type) {
+	case H_VALUE:
+	case H_IMAGINARITY_CONST:
+	case H_FUNCTION_DEF:
+		return depth + 1;
+
+	case H_ARRAY_DEF:
+		return 1;
+
+	case H_POP:
+	case H_CREATE_VARIABLE:
+		return depth != 0 ? depth - 1 : 0;
+
+	case H_COPY:
+	case H_ARR_GET:
+		return (depth != 0 ? depth : 1) + 1;
+
+	case H_FLIP:
+		return depth > 2 ? depth : 2;
+
+	default:
+		if ((operands = arity(instr)) < 0)
+			return 0;
+
+		return (depth > (size_t) operands ? depth - operands : 0) + 1;
+	}
+}
+
+static bool is_pair(const struct h_instr_stack* instr_stack, enum h_instr_type first, enum h_instr_type second)
+{
+	return instr_stack->count >= 2 && instr_stack->instrs[instr_stack->count - 2].type == first
+		&& instr_stack->instrs[instr_stack->count - 1].type == second;
+}
+
+static void eliminate_noops(struct h_instr_stack* instr_stack)
+{
+	struct h_instr_stack kept  = { .arena = instr_stack->arena, .root_stack = instr_stack->root_stack };
+	struct h_base_stack depths = {0};
+
+	for (size_t i = 0; i < instr_stack->count; i++) {
+		struct h_instr* instr = &instr_stack->instrs[i];
+		size_t depth          = depths.count != 0 ? ((size_t*) depths.ptr)[depths.count - 1] : 0;
+
+		if (instr->type == H_ARRAY_DEF)
+			eliminate_noops(&instr->value.array_def);
+
+		if (instr->type == H_FUNCTION_DEF)
+			eliminate_noops(&instr->value.function_def);
+
+		h_instr_stack_push(&kept, instr);
+
+		depth = next_depth(instr, depth);
+		h_base_stack_push(&depths, &depth, sizeof(size_t));
+
+		size_t before = depths.count > 2 ? ((size_t*) depths.ptr)[depths.count - 3] : 0;
+		size_t drop   = 0;
+
+		if (is_pair(&kept, H_COPY, H_FLIP))
+			drop = 1;
+		else if (is_pair(&kept, H_COPY, H_POP) && before >= 1)
+			drop = 2;
+		else if (is_pair(&kept, H_FLIP, H_FLIP) && before >= 2)
+			drop = 2;
+
+		for (; drop != 0; drop--) {
+			h_instr_stack_free_instr(&kept.instrs[--kept.count]);
+			depths.count--;
+		}
+	}
+
+	if (instr_stack->arena == NULL)
+		free(instr_stack->instrs);
+
+	free(depths.ptr);
+
+	*instr_stack = kept;
+}
+
+void h_optimize(struct h_instr_stack* instr_stack)
+{
+	fold_constants(instr_stack);
+	propagate_bindings(instr_stack);
+	fold_constants(instr_stack);
+	eliminate_noops(instr_stack);
+}
@@ -74,38 +74,38 @@ static struct h_error parse_tok(const struct h_lexer_tok* tok, struct h_instr* i
 		};
 
 	case H_TOK_NUMBER:
-		instr->type                     = H_VALUE;
-		instr->value.value.type         = H_NUMBER;
-		instr->value.value.value.number = tok->value.number;
+		instr->type        = H_VALUE;
+		instr->value.value = h_make_real(tok->value.number);
+
+		if (tok->value.number <= H_MAX_EXACT_INTEGER && tok->value.number == (int64_t) tok->value.number)
+			instr->value.value = h_make_integer(tok->value.number);
 
 		break;
 
 	case H_TOK_IMAGINARITY:
-		instr->type                     = H_VALUE;
-		instr->value.value.type         = H_NUMBER;
-		instr->value.value.value.number = I;
+		instr->type        = H_VALUE;
+		instr->value.value = h_make_number(I);
 
 		break;
 
 	case H_TOK_FN_CLOSE: {
-		struct h_instr_stack instrs = {0};
+		struct h_instr_stack sub_instrs = { .arena = instrs->arena };
 
-		continue_or_return_if_error(parse_subcode(H_TOK_FN_OPEN, &instrs, lexer));
+		continue_or_return_if_error(parse_subcode(H_TOK_FN_OPEN, &sub_instrs, lexer));
 
-		instr->type                       = H_VALUE;
-		instr->value.value.type           = H_FUNCTION;
-		instr->value.value.value.function = instrs;
+		instr->type               = H_FUNCTION_DEF;
+		instr->value.function_def = sub_instrs;
 
 		break;
 	}
 	
 	case H_TOK_ARRAY_CLOSE: {
-		struct h_instr_stack instrs = {0};
+		struct h_instr_stack sub_instrs = { .arena = instrs->arena };
 
-		continue_or_return_if_error(parse_subcode(H_TOK_ARRAY_OPEN, &instrs, lexer));
+		continue_or_return_if_error(parse_subcode(H_TOK_ARRAY_OPEN, &sub_instrs, lexer));
 
 		instr->type            = H_ARRAY_DEF;
-		instr->value.array_def = instrs;
+		instr->value.array_def = sub_instrs;
 
 		break;
 	}
@@ -131,17 +131,9 @@ static struct h_error parse_tok(const struct h_lexer_tok* tok, struct h_instr* i
 		break;
 
 	case H_TOK_STRING:
-		instr->type = H_ARRAY_DEF;
-
-		for (const char* c = tok->value.string; *c != '\0'; c++) {
-			struct h_instr char_instr = (struct h_instr) {
-				.type                        = H_VALUE,
-				.value.value.type            = H_CHAR,
-				.value.value.value.charester = *c,
-			};
-
-			h_instr_stack_push(&instr->value.array_def, &char_instr);
-		}
+		instr->type        = H_VALUE;
+		instr->value.value = h_make_array(h_array_from_bytes(instrs->arena, tok->value.string,
+					strlen(tok->value.string)));
 
 		break;
 
@@ -189,6 +181,21 @@ static struct h_error parse_tok(const struct h_lexer_tok* tok, struct h_instr* i
 		instr->type = H_ARR_CAT;
 
 		break;
+
+	case H_TOK_ARR_TAKE:
+		instr->type = H_ARR_TAKE;
+
+		break;
+
+	case H_TOK_ARR_DROP:
+		instr->type = H_ARR_DROP;
+
+		break;
+
+	case H_TOK_ARR_STEP:
+		instr->type = H_ARR_STEP;
+
+		break;
 	
 	case H_TOK_EQUALS:
 		instr->type = H_EQUALS;
@@ -0,0 +1,528 @@
+/*
+	Permission to use, copy, modify, and/or distribute this software for
+	any purpose with or without fee is hereby granted.
+
+	THE SOFTWARE IS PROVIDED “AS IS” AND THE AUTHOR DISCLAIMS ALL
+	WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+	FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+	DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+	AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <stdbool.h>
+#include <complex.h>
+#include <string.h>
+
+#include "h.h"
+
+#define return_ok() return (struct h_error) { .type = H_OK }
+
+struct translation {
+	struct h_register_code* code;
+
+	uint8_t stack[H_MAX_REGISTERS];
+	size_t depth;
+
+	uint32_t constant_indices[H_MAX_REGISTERS];
+};
+
+static bool is_binary_op(enum h_instr_type type)
+{
+	switch (type) {
+	case H_ADD:
+	case H_SUB:
+	case H_MUL:
+	case H_DIV:
+	case H_POW:
+	case H_EQUALS:
+	case H_NOT_EQUALS:
+	case H_MORE:
+	case H_LESS:
+	case H_MORE_OR_EQUALS:
+	case H_LESS_OR_EQUALS:
+	case H_AND:
+	case H_OR:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+static size_t op_sources(const struct h_register_op* op)
+{
+	if (op->type == H_CALL_SUMBOIL)
+		return 0;
+
+	return is_binary_op(op->type) ? 2 : 1;
+}
+
+static bool push_register(struct translation* translation, uint8_t index)
+{
+	if (translation->depth == H_MAX_REGISTERS)
+		return false;
+
+	translation->stack[translation->depth++] = index;
+
+	return true;
+}
+
+static bool emit(struct translation* translation, enum h_instr_type type, size_t sources, uint32_t offset)
+{
+	struct h_register_code* code = translation->code;
+
+	if (translation->depth < sources || code->temporaries >= code->constants)
+		return false;
+
+	struct h_register_op* op = &code->ops[code->count++];
+
+	*op = (struct h_register_op) {
+		.type    = type,
+		.target  = code->temporaries++,
+		.source0 = translation->stack[translation->depth - 1],
+		.source1 = sources == 2 ? translation->stack[translation->depth - 2] : 0,
+		.offset  = offset,
+	};
+
+	translation->depth -= sources;
+
+	return push_register(translation, op->target);
+}
+
+static bool emit_load(struct translation* translation, uint32_t operand, uint32_t offset)
+{
+	struct h_register_code* code = translation->code;
+
+	if (code->constants == code->temporaries)
+		return false;
+
+	code->ops[code->count++] = (struct h_register_op) {
+		.type    = H_CALL_SUMBOIL,
+		.target  = --code->constants,
+		.operand = code->program->slots[operand],
+		.offset  = offset,
+	};
+
+	translation->constant_indices[code->constants] = UINT32_MAX;
+
+	return push_register(translation, code->constants);
+}
+
+static bool emit_constant(struct translation* translation, uint32_t operand)
+{
+	struct h_register_code* code = translation->code;
+
+	for (size_t i = code->constants; i < H_MAX_REGISTERS; i++)
+		if (translation->constant_indices[i] == operand)
+			return push_register(translation, i);
+
+	if (code->constants == code->temporaries)
+		return false;
+
+	code->registers[--code->constants]             = code->program->constants.value[operand];
+	translation->constant_indices[code->constants] = operand;
+
+	return push_register(translation, code->constants);
+}
+
+static bool translate_op(struct translation* translation, enum h_instr_type type, uint32_t operand,
+		uint32_t offset)
+{
+	uint8_t top;
+
+	if (is_binary_op(type))
+		return emit(translation, type, 2, offset);
+
+	switch (type) {
+	case H_CONST:
+		return emit_constant(translation, operand);
+
+	case H_CALL_SUMBOIL:
+		return emit_load(translation, operand, offset);
+
+	case H_REAL:
+	case H_IMAG:
+	case H_NOT:
+		return emit(translation, type, 1, offset);
+
+	case H_POP:
+		if (translation->depth < 1)
+			return false;
+
+		translation->depth--;
+
+		return true;
+
+	case H_COPY:
+		if (translation->depth < 1)
+			return false;
+
+		return push_register(translation, translation->stack[translation->depth - 1]);
+
+	case H_FLIP:
+		if (translation->depth < 2)
+			return false;
+
+		top = translation->stack[translation->depth - 1];
+
+		translation->stack[translation->depth - 1] = translation->stack[translation->depth - 2];
+		translation->stack[translation->depth - 2] = top;
+
+		return true;
+
+	case H_NUMBER_OP:
+		return translate_op(translation, operand, 0, offset);
+
+	default:
+		if ((unsigned) type >= H_INSTR_TYPE_COUNT || h_fusions[type].first == H_VALUE)
+			return false;
+
+		return translate_op(translation, h_fusions[type].first, operand, offset)
+			&& translate_op(translation, h_fusions[type].second,
+					operand + h_op_operands(h_fusions[type].first), offset);
+	}
+}
+
+static bool is_invariant(const bool* invariant, const struct h_register_op* op)
+{
+	if (op->type == H_CALL_SUMBOIL)
+		return true;
+
+	for (size_t i = 0; i < op_sources(op); i++)
+		if (!invariant[i == 0 ? op->source0 : op->source1])
+			return false;
+
+	return true;
+}
+
+static void partition(struct h_register_code* code, bool hoist)
+{
+	struct h_register_op ops[H_MAX_REGISTERS];
+	bool invariant[H_MAX_REGISTERS] = {0};
+	size_t count                    = 0;
+
+	for (size_t i = code->constants; i < H_MAX_REGISTERS; i++)
+		invariant[i] = true;
+
+	for (size_t i = 0; i < code->count; i++)
+		if (code->ops[i].type == H_CALL_SUMBOIL || (hoist && is_invariant(invariant, &code->ops[i]))) {
+			invariant[code->ops[i].target] = true;
+			ops[count++] = code->ops[i];
+		}
+
+	code->invariants = count;
+
+	for (size_t i = 0; i < code->count; i++)
+		if (!invariant[code->ops[i].target])
+			ops[count++] = code->ops[i];
+
+	memcpy(code->ops, ops, count * sizeof(struct h_register_op));
+}
+
+bool h_translate_registers(const struct h_function* function, size_t arguments, struct h_register_code* code)
+{
+	if (arguments >= H_MAX_REGISTERS)
+		return false;
+
+	*code = (struct h_register_code) {
+		.program     = function->program,
+		.arguments   = arguments,
+		.temporaries = arguments,
+		.constants   = H_MAX_REGISTERS,
+	};
+
+	struct translation translation = { .code = code, .depth = arguments };
+
+	for (size_t i = 0; i < arguments; i++)
+		translation.stack[i] = i;
+
+	const struct h_op* op = h_function_code(function);
+
+	for (size_t i = 0; i < function->count; i++)
+		if (!translate_op(&translation, h_op_generic(h_op_type(&op[i])), op[i].operand, op + i - function->program->code.ops))
+			return false;
+
+	if (translation.depth == 0)
+		return false;
+
+	code->result = translation.stack[translation.depth - 1];
+
+	partition(code, false);
+
+	return true;
+}
+
+static void rename_register(struct h_register_code* code, size_t from, uint8_t old, uint8_t new)
+{
+	for (size_t i = from; i < code->count; i++) {
+		if (code->ops[i].source0 == old)
+			code->ops[i].source0 = new;
+
+		if (code->ops[i].source1 == old && op_sources(&code->ops[i]) == 2)
+			code->ops[i].source1 = new;
+	}
+
+	if (code->result == old)
+		code->result = new;
+}
+
+static bool is_same_op(const struct h_register_op* a, const struct h_register_op* b)
+{
+	return a->type == b->type && a->operand == b->operand && a->source0 == b->source0
+		&& (op_sources(a) < 2 || a->source1 == b->source1);
+}
+
+static void remove_ops(struct h_register_code* code, const bool* removed)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < code->count; i++)
+		if (!removed[i])
+			code->ops[count++] = code->ops[i];
+
+	code->count = count;
+}
+
+static void eliminate_common_subexpressions(struct h_register_code* code)
+{
+	bool removed[H_MAX_REGISTERS] = {0};
+
+	for (size_t i = 0; i < code->count; i++)
+		for (size_t j = 0; j < i; j++) {
+			if (removed[j] || !is_same_op(&code->ops[i], &code->ops[j]))
+				continue;
+
+			rename_register(code, i + 1, code->ops[i].target, code->ops[j].target);
+			removed[i] = true;
+
+			break;
+		}
+
+	remove_ops(code, removed);
+}
+
+static bool is_constant_register(const struct h_register_code* code, const bool* loaded, uint8_t index)
+{
+	return index >= code->constants && !loaded[index];
+}
+
+static bool is_number_register(const struct h_register_code* code, const bool* computed, const bool* loaded,
+		uint8_t index)
+{
+	return computed[index] || (is_constant_register(code, loaded, index)
+			&& h_value_get_type(&code->registers[index]) == H_NUMBER);
+}
+
+static bool can_fail(const struct h_register_code* code, const bool* computed, const bool* loaded,
+		const struct h_register_op* op)
+{
+	if (op->type == H_CALL_SUMBOIL || !is_number_register(code, computed, loaded, op->source0))
+		return true;
+
+	if (op_sources(op) == 2 && !is_number_register(code, computed, loaded, op->source1))
+		return true;
+
+	return op->type == H_DIV && (!is_constant_register(code, loaded, op->source1)
+			|| !h_number_is_true(&code->registers[op->source1]));
+}
+
+static void eliminate_dead_code(struct h_register_code* code)
+{
+	bool removed[H_MAX_REGISTERS]  = {0};
+	bool live[H_MAX_REGISTERS]     = {0};
+	bool computed[H_MAX_REGISTERS] = {0};
+	bool loaded[H_MAX_REGISTERS]   = {0};
+
+	for (size_t i = 0; i < code->count; i++) {
+		if (code->ops[i].type == H_CALL_SUMBOIL)
+			loaded[code->ops[i].target] = true;
+		else
+			computed[code->ops[i].target] = true;
+	}
+
+	live[code->result] = true;
+
+	for (size_t i = code->count; i-- > 0;) {
+		const struct h_register_op* op = &code->ops[i];
+
+		if (!live[op->target] && !can_fail(code, computed, loaded, op)) {
+			removed[i] = true;
+			continue;
+		}
+
+		for (size_t j = 0; j < op_sources(op); j++)
+			live[j == 0 ? op->source0 : op->source1] = true;
+	}
+
+	remove_ops(code, removed);
+}
+
+void h_optimize_registers(struct h_register_code* code, unsigned level)
+{
+	if (level == 0)
+		return;
+
+	eliminate_common_subexpressions(code);
+	eliminate_dead_code(code);
+
+	partition(code, level >= 2);
+}
+
+static struct h_error type_error(const struct h_value* value)
+{
+	return (struct h_error) {
+		.type = H_ERROR_TYPE_ERROR,
+		.value.type_error.excepted = H_NUMBER,
+		.value.type_error.got      = h_value_get_type(value),
+	};
+}
+
+static struct h_error execute_op(const struct h_register_op* op, struct h_value* registers)
+{
+	const struct h_value* value0 = &registers[op->source0];
+	const struct h_value* value1 = &registers[op->source1];
+	struct h_value* result       = &registers[op->target];
+	int order;
+
+	if (h_value_get_type(value0) != H_NUMBER)
+		return type_error(value0);
+
+	if (is_binary_op(op->type) && h_value_get_type(value1) != H_NUMBER)
+		return type_error(value1);
+
+	switch (op->type) {
+	case H_ADD: *result = h_number_add(value0, value1); break;
+	case H_SUB: *result = h_number_sub(value0, value1); break;
+	case H_MUL: *result = h_number_mul(value0, value1); break;
+	case H_POW: *result = h_number_pow(value1, value0); break;
+
+	case H_DIV:
+		if (!h_number_is_true(value1))
+			return (struct h_error) { .type = H_ERROR_DIVISON_BY_ZERO };
+
+		*result = h_number_div(value0, value1);
+		break;
+
+	case H_EQUALS: *result = h_make_integer(h_number_equals(value0, value1)); break;
+	case H_NOT_EQUALS: *result = h_make_integer(!h_number_equals(value0, value1)); break;
+	case H_MORE: *result = h_make_integer(h_number_compare(value0, value1) == 1); break;
+	case H_LESS: *result = h_make_integer(h_number_compare(value0, value1) == -1); break;
+
+	case H_MORE_OR_EQUALS:
+		order   = h_number_compare(value0, value1);
+		*result = h_make_integer(order == 0 || order == 1);
+		break;
+
+	case H_LESS_OR_EQUALS:
+		order   = h_number_compare(value0, value1);
+		*result = h_make_integer(order == 0 || order == -1);
+		break;
+
+	case H_AND: *result = h_make_integer(h_number_is_true(value0) && h_number_is_true(value1)); break;
+	case H_OR: *result = h_make_integer(h_number_is_true(value0) || h_number_is_true(value1)); break;
+	case H_NOT: *result = h_make_integer(!h_number_is_true(value0)); break;
+
+	case H_REAL:
+		if (h_value_get_number_kind(value0) != H_NUMBER_COMPLEX) {
+			*result = *value0;
+			h_value_retain(result);
+
+			break;
+		}
+
+		*result = h_make_real(creal(h_value_get_number(value0)));
+		break;
+
+	case H_IMAG:
+		*result = h_value_get_number_kind(value0) == H_NUMBER_INTEGER
+				|| h_value_get_number_kind(value0) == H_NUMBER_BIG
+			? h_make_integer(0) : h_make_real(cimag(h_value_get_number(value0)));
+		break;
+
+	default:
+		return (struct h_error) { .type = H_ERROR_UNDEFINED_VM_INSTRUCTION };
+	}
+
+	return_ok();
+}
+
+static void release_ops(struct h_register_code* code, size_t from, size_t to, size_t kept)
+{
+	for (size_t i = from; i < to; i++)
+		if (code->ops[i].type != H_CALL_SUMBOIL && code->ops[i].target != kept)
+			h_value_release(&code->registers[code->ops[i].target]);
+}
+
+bool h_prepare_registers(struct h_register_code* code, struct h_runtime* runtime)
+{
+	for (size_t i = 0; i < code->invariants; i++) {
+		const struct h_register_op* op = &code->ops[i];
+
+		if (op->type != H_CALL_SUMBOIL) {
+			if (execute_op(op, code->registers).type == H_OK)
+				continue;
+
+			release_ops(code, 0, i, H_MAX_REGISTERS);
+
+			return false;
+		}
+
+		struct h_value* value = h_sumboil_stack_get(&runtime->sumboil_stack, op->operand);
+
+		if (value == NULL || h_value_get_type(value) == H_FUNCTION) {
+			release_ops(code, 0, i, H_MAX_REGISTERS);
+
+			return false;
+		}
+
+		code->registers[op->target] = *value;
+	}
+
+	return true;
+}
+
+struct h_error h_execute_registers(struct h_register_code* code, const struct h_value* arguments,
+		struct h_value* result)
+{
+	memcpy(code->registers, arguments, code->arguments * sizeof(struct h_value));
+
+	if (code->native != NULL && code->native->entry(code->registers)) {
+		*result = code->registers[code->result];
+
+		return_ok();
+	}
+
+	for (size_t i = code->invariants; i < code->count; i++) {
+		struct h_error error = execute_op(&code->ops[i], code->registers);
+
+		if (error.type != H_OK) {
+			release_ops(code, code->invariants, i, H_MAX_REGISTERS);
+
+			if (error.source.source_type == H_ERROR_SOURCE_NONE)
+				error.source = h_program_source(code->program, code->ops[i].offset);
+
+			return error;
+		}
+	}
+
+	bool is_owned = false;
+
+	for (size_t i = code->invariants; i < code->count; i++)
+		is_owned |= code->ops[i].type != H_CALL_SUMBOIL && code->ops[i].target == code->result;
+
+	*result = code->registers[code->result];
+
+	if (!is_owned)
+		h_value_retain(result);
+
+	release_ops(code, code->invariants, code->count, code->result);
+
+	return_ok();
+}
+
+void h_release_registers(struct h_register_code* code)
+{
+	release_ops(code, 0, code->invariants, H_MAX_REGISTERS);
+}
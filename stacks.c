@@ -17,19 +17,46 @@
 
 #define return_ok() return (struct h_error) { .type = H_OK }
 
+static void resize(struct h_base_stack* stack, size_t capacity, size_t data_size)
+{
+	if (stack->arena != NULL)
+		stack->ptr = h_arena_realloc(stack->arena, stack->ptr, data_size * stack->capacity,
+				data_size * capacity);
+	else
+		stack->ptr = realloc(stack->ptr, data_size * capacity);
+
+	stack->capacity = capacity;
+}
+
+void h_base_stack_reserve(struct h_base_stack* stack, size_t count, size_t data_size)
+{
+	if (stack->count + count <= stack->capacity)
+		return;
+
+	size_t capacity = stack->capacity < H_MIN_STACK_CAPACITY ? H_MIN_STACK_CAPACITY : stack->capacity;
+	while (capacity < stack->count + count)
+		capacity *= 2;
+
+	resize(stack, capacity, data_size);
+}
+
 void h_base_stack_push(struct h_base_stack* stack, const void* data, size_t data_size)
 {
-	if (stack->count == 0) {
-		stack->ptr   = malloc(data_size);
-		stack->count = 1;
+	if (stack->count == stack->capacity)
+		h_base_stack_reserve(stack, 1, data_size);
 
-		memcpy(stack->ptr, data, data_size);
+	memcpy(stack->ptr + data_size * stack->count++, data, data_size);
+}
 
+void h_base_stack_append_n(struct h_base_stack* stack, const void* data, size_t count, size_t data_size)
+{
+	if (count == 0)
 		return;
-	}
 
-	stack->ptr = realloc(stack->ptr, data_size * ++stack->count);
-	memcpy(stack->ptr + data_size * (stack->count - 1), data, data_size);
+	h_base_stack_reserve(stack, count, data_size);
+
+	memcpy(stack->ptr + data_size * stack->count, data, data_size * count);
+	stack->count += count;
 }
 
 void h_base_stack_drop(struct h_base_stack* stack, size_t data_size)
@@ -41,13 +68,9 @@ void h_base_stack_drop(struct h_base_stack* stack, size_t data_size)
 
 	stack->count--;
 
-	if (stack->count == 0) {
-		free(stack->ptr);
-		stack->ptr = NULL;
-		return;
-	}
-
-	stack->ptr = realloc(stack->ptr, data_size * stack->count);
+	if (stack->arena == NULL && stack->capacity > H_MIN_STACK_CAPACITY
+			&& stack->count < stack->capacity / 4)
+		resize(stack, stack->capacity / 2, data_size);
 }
 
 void* h_base_stack_peek(const struct h_base_stack* stack, size_t data_size)
@@ -58,6 +81,11 @@ void* h_base_stack_peek(const struct h_base_stack* stack, size_t data_size)
 	return stack->ptr + data_size * (stack->count - 1);
 }
 
+void h_instr_stack_reserve(struct h_instr_stack* stack, size_t count)
+{
+	h_base_stack_reserve((struct h_base_stack*) stack, count, sizeof(struct h_instr));
+}
+
 void h_instr_stack_push(struct h_instr_stack* stack, const struct h_instr* data)
 {
 	h_base_stack_push((struct h_base_stack*) stack, data, sizeof(struct h_instr));
@@ -88,6 +116,14 @@ void h_instr_stack_free_instr(struct h_instr* instr)
 		h_instr_stack_free(&instr->value.array_def);
 		break;
 
+	case H_FUNCTION_DEF:
+		h_instr_stack_free(&instr->value.function_def);
+		break;
+
+	case H_VALUE:
+		h_value_release(&instr->value.value);
+		break;
+
 	default:
 		break;
 	}
@@ -95,91 +131,79 @@ void h_instr_stack_free_instr(struct h_instr* instr)
 
 void h_instr_stack_free(struct h_instr_stack* stack)
 {
+	if (stack->arena != NULL)
+		return;
+
 	for (int i = 0; i < stack->count; i++)
 		h_instr_stack_free_instr(&stack->instrs[i]);
 
 	free(stack->instrs);
 }
 
+void h_value_stack_reserve(struct h_value_stack* stack, size_t count)
+{
+	h_base_stack_reserve((struct h_base_stack*) stack, count, sizeof(struct h_value));
+}
+
 void h_value_stack_push(struct h_value_stack* stack, const struct h_value* data)
 {
 	h_base_stack_push((struct h_base_stack*) stack, data, sizeof(struct h_value));
 }
 
-struct h_error h_value_stack_drop(struct h_value_stack* stack, const struct h_source* source)
+void h_value_stack_append_n(struct h_value_stack* stack, const struct h_value* data, size_t count)
+{
+	h_base_stack_append_n((struct h_base_stack*) stack, data, count, sizeof(struct h_value));
+}
+
+struct h_error h_value_stack_drop(struct h_value_stack* stack)
 {
 	if (stack->count == 0 && stack->root_stack == NULL)
-		return (struct h_error) {
-			.type   = H_ERROR_EMPTY_STACK,
-			.source = *source,
-		};
+		return (struct h_error) { .type = H_ERROR_EMPTY_STACK };
 
 	h_base_stack_drop((struct h_base_stack*) stack, sizeof(struct h_value));
 
 	return_ok();
 }
 
-struct h_value_stack_peek_result h_value_stack_peek(const struct h_value_stack* stack,
-		const struct h_source* source)
+struct h_value_stack_peek_result h_value_stack_peek(const struct h_value_stack* stack)
 {
 	if (stack->count == 0 && stack->root_stack == NULL)
 		return (struct h_value_stack_peek_result) {
 			.value = NULL,
-			.error = (struct h_error) {
-			.type   = H_ERROR_EMPTY_STACK,
-				.source = *source,
-			},
+			.error = (struct h_error) { .type = H_ERROR_EMPTY_STACK },
 		};
 
 	if (stack->count == 0)
-		return h_value_stack_peek(stack->root_stack, source);
+		return h_value_stack_peek(stack->root_stack);
 
 	return (struct h_value_stack_peek_result) {
 		.value = h_base_stack_peek((struct h_base_stack*) stack, sizeof(struct h_value)),
-		.error = (struct h_error) {
-			.type   = H_OK,
-			.source = *source,
-		},
+		.error = (struct h_error) { .type = H_OK },
 	};
 }
 
-struct h_value_stack_pop_result h_value_stack_pop(struct h_value_stack* stack,
-		const struct h_source* source)
+struct h_value_stack_pop_result h_value_stack_pop(struct h_value_stack* stack)
 {
-	struct h_value_stack_peek_result value = h_value_stack_peek(stack, source);
+	struct h_value_stack_peek_result value = h_value_stack_peek(stack);
 	if (value.error.type != H_OK)
 		return (struct h_value_stack_pop_result) {
 			.error = value.error,
-			.value = {0},
+			.value = { .value = { .integer = 0 } },
 		};
 
 	struct h_value value_value = *value.value;
 
-	h_value_stack_drop(stack, source);
+	h_value_stack_drop(stack);
 
 	return (struct h_value_stack_pop_result) {
 		.value = value_value,
-		.error = (struct h_error) {
-			.type   = H_OK,
-			.source = *source,
-		},
+		.error = (struct h_error) { .type = H_OK },
 	};
 }
 
 void h_value_stack_free_value(struct h_value* value)
 {
-	switch (value->type) {
-	case H_FUNCTION:
-		h_instr_stack_free(&value->value.function);
-		break;
-
-	case H_ARRAY:
-		h_value_stack_free(&value->value.array);
-		break;
-
-	default:
-		break;
-	}
+	h_value_release(value);
 }
 
 void h_value_stack_free(struct h_value_stack* stack)
@@ -187,38 +211,100 @@ void h_value_stack_free(struct h_value_stack* stack)
 	for (int i = 0; i < stack->count; i++)
 		h_value_stack_free_value(&stack->value[i]);
 
-	if (stack->value != NULL)
+	if (stack->value != NULL && stack->arena == NULL)
 		free(stack->value);
 
-	stack->value = NULL;
+	stack->value    = NULL;
+	stack->count    = 0;
+	stack->capacity = 0;
 }
 
-void h_sumboil_stack_push(struct h_sumboil_stack* stack, const struct h_sumboil* data)
+void h_op_stack_push(struct h_op_stack* stack, const struct h_op* data)
 {
-	h_base_stack_push((struct h_base_stack*) stack, data, sizeof(struct h_sumboil));
+	h_base_stack_push((struct h_base_stack*) stack, data, sizeof(struct h_op));
 }
 
-void h_sumboil_stack_drop(struct h_sumboil_stack* stack)
+void h_line_stack_push(struct h_line_stack* stack, const struct h_line* data)
 {
-	h_base_stack_drop((struct h_base_stack*) stack, sizeof(struct h_sumboil));
+	h_base_stack_push((struct h_base_stack*) stack, data, sizeof(struct h_line));
 }
 
-struct h_sumboil* h_sumboil_stack_peek(const struct h_sumboil_stack* stack)
+void h_symbol_stack_push(struct h_symbol_stack* stack, const char* name)
 {
-	return h_base_stack_peek((struct h_base_stack*) stack, sizeof(struct h_sumboil));
+	size_t size = strlen(name) + 1;
+	char* copy  = stack->arena != NULL ? h_arena_alloc(stack->arena, size) : malloc(size);
+
+	memcpy(copy, name, size);
+
+	h_base_stack_push((struct h_base_stack*) stack, &copy, sizeof(char*));
 }
 
-struct h_sumboil h_sumboil_stack_pop(struct h_sumboil_stack* stack)
+void h_symbol_stack_free(struct h_symbol_stack* stack)
 {
-	struct h_sumboil sumboil = *h_sumboil_stack_peek(stack);
-	h_sumboil_stack_drop(stack);
+	if (stack->arena != NULL)
+		return;
 
-	return sumboil;
+	for (int i = 0; i < stack->count; i++)
+		free(stack->names[i]);
+
+	if (stack->names != NULL)
+		free(stack->names);
+
+	stack->names    = NULL;
+	stack->count    = 0;
+	stack->capacity = 0;
+}
+
+struct h_value* h_sumboil_stack_get(const struct h_sumboil_stack* stack, uint32_t slot)
+{
+	if (slot >= stack->count || !stack->sumboils[slot].defined)
+		return NULL;
+
+	return &stack->sumboils[slot].value;
+}
+
+void h_sumboil_stack_set(struct h_sumboil_stack* stack, uint32_t slot, struct h_value value)
+{
+	if (slot >= stack->count) {
+		h_base_stack_reserve((struct h_base_stack*) stack, slot + 1 - stack->count, sizeof(struct h_sumboil));
+		memset(&stack->sumboils[stack->count], 0, (slot + 1 - stack->count) * sizeof(struct h_sumboil));
+
+		stack->count = slot + 1;
+	}
+
+	struct h_sumboil* sumboil = &stack->sumboils[slot];
+
+	if (sumboil->defined)
+		h_value_release(&sumboil->value);
+
+	*sumboil = (struct h_sumboil) {
+		.defined = true,
+		.version = sumboil->version + 1,
+		.value   = value,
+	};
+}
+
+void h_sumboil_stack_reserve_caches(struct h_sumboil_stack* stack, size_t count)
+{
+	if (count <= stack->cache_count)
+		return;
+
+	size_t old_size = stack->cache_count * sizeof(struct h_sumboil_cache);
+	size_t size     = count * sizeof(struct h_sumboil_cache);
+
+	if (stack->arena != NULL)
+		stack->caches = h_arena_realloc(stack->arena, stack->caches, old_size, size);
+	else
+		stack->caches = realloc(stack->caches, size);
+
+	memset(&stack->caches[stack->cache_count], 0, size - old_size);
+	stack->cache_count = count;
 }
 
 void h_sumboil_stack_free_sumboil(struct h_sumboil* sumboil)
 {
-	h_value_stack_free_value(&sumboil->value);
+	if (sumboil->defined)
+		h_value_stack_free_value(&sumboil->value);
 }
 
 void h_sumboil_stack_free(struct h_sumboil_stack* stack)
@@ -226,8 +312,15 @@ void h_sumboil_stack_free(struct h_sumboil_stack* stack)
 	for (int i = 0; i < stack->count; i++)
 		h_sumboil_stack_free_sumboil(&stack->sumboils[i]);
 
-	if (stack->sumboils != NULL)
+	if (stack->sumboils != NULL && stack->arena == NULL)
 		free(stack->sumboils);
 
-	stack->sumboils = NULL;
+	if (stack->caches != NULL && stack->arena == NULL)
+		free(stack->caches);
+
+	stack->sumboils    = NULL;
+	stack->count       = 0;
+	stack->capacity    = 0;
+	stack->caches      = NULL;
+	stack->cache_count = 0;
 }
@@ -0,0 +1,257 @@
+/*
+	Permission to use, copy, modify, and/or distribute this software for
+	any purpose with or without fee is hereby granted.
+
+	THE SOFTWARE IS PROVIDED “AS IS” AND THE AUTHOR DISCLAIMS ALL
+	WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+	FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+	DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+	AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "h.h"
+
+static struct h_tree_node* allocate(struct h_arena* arena, size_t size)
+{
+	return arena != NULL ? h_arena_alloc(arena, size) : malloc(size);
+}
+
+static struct h_tree_node* create_leaf(struct h_arena* arena)
+{
+	struct h_tree_node* leaf = allocate(arena,
+			sizeof(struct h_tree_node) + H_TREE_LEAF_SIZE * sizeof(struct h_value));
+
+	*leaf = (struct h_tree_node) {
+		.ref_count = 1,
+		.arena     = arena,
+	};
+
+	return leaf;
+}
+
+static struct h_tree_node* create_branch(struct h_arena* arena, struct h_tree_node* left,
+		struct h_tree_node* right)
+{
+	struct h_tree_node* branch = allocate(arena, sizeof(struct h_tree_node));
+
+	*branch = (struct h_tree_node) {
+		.ref_count = 1,
+		.count     = left->count + right->count,
+		.height    = (left->height > right->height ? left->height : right->height) + 1,
+		.arena     = arena,
+		.left      = left,
+		.right     = right,
+	};
+
+	return branch;
+}
+
+void h_tree_retain(struct h_tree_node* node)
+{
+	if (node != NULL)
+		__atomic_fetch_add(&node->ref_count, 1, __ATOMIC_RELAXED);
+}
+
+void h_tree_release(struct h_tree_node* node)
+{
+	if (node == NULL || __atomic_sub_fetch(&node->ref_count, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
+
+	if (node->height == 0) {
+		for (size_t i = 0; i < node->count; i++)
+			h_value_release(&node->values[i]);
+	} else {
+		h_tree_release(node->left);
+		h_tree_release(node->right);
+	}
+
+	if (node->arena == NULL)
+		free(node);
+}
+
+static struct h_tree_node* unique(struct h_arena* arena, struct h_tree_node* node)
+{
+	if (__atomic_load_n(&node->ref_count, __ATOMIC_ACQUIRE) == 1)
+		return node;
+
+	struct h_tree_node* copy;
+
+	if (node->height == 0) {
+		copy        = create_leaf(arena);
+		copy->count = node->count;
+
+		memcpy(copy->values, node->values, node->count * sizeof(struct h_value));
+
+		for (size_t i = 0; i < copy->count; i++)
+			h_value_retain(&copy->values[i]);
+	} else {
+		h_tree_retain(node->left);
+		h_tree_retain(node->right);
+
+		copy = create_branch(arena, node->left, node->right);
+	}
+
+	h_tree_release(node);
+
+	return copy;
+}
+
+static void take_children(struct h_tree_node* node, struct h_tree_node** left, struct h_tree_node** right)
+{
+	*left  = node->left;
+	*right = node->right;
+
+	h_tree_retain(*left);
+	h_tree_retain(*right);
+	h_tree_release(node);
+}
+
+static struct h_tree_node* merge_leaves(struct h_arena* arena, struct h_tree_node* left,
+		struct h_tree_node* right)
+{
+	left = unique(arena, left);
+
+	for (size_t i = 0; i < right->count; i++) {
+		left->values[left->count] = right->values[i];
+		h_value_retain(&left->values[left->count++]);
+	}
+
+	h_tree_release(right);
+
+	return left;
+}
+
+static struct h_tree_node* balance(struct h_arena* arena, struct h_tree_node* left, struct h_tree_node* right)
+{
+	struct h_tree_node* outer;
+	struct h_tree_node* inner;
+	struct h_tree_node* inner_left;
+	struct h_tree_node* inner_right;
+
+	if (left->height > right->height + 1) {
+		take_children(left, &outer, &inner);
+
+		if (outer->height >= inner->height)
+			return create_branch(arena, outer, create_branch(arena, inner, right));
+
+		take_children(inner, &inner_left, &inner_right);
+
+		return create_branch(arena, create_branch(arena, outer, inner_left),
+				create_branch(arena, inner_right, right));
+	}
+
+	if (right->height > left->height + 1) {
+		take_children(right, &inner, &outer);
+
+		if (outer->height >= inner->height)
+			return create_branch(arena, create_branch(arena, left, inner), outer);
+
+		take_children(inner, &inner_left, &inner_right);
+
+		return create_branch(arena, create_branch(arena, left, inner_left),
+				create_branch(arena, inner_right, outer));
+	}
+
+	return create_branch(arena, left, right);
+}
+
+struct h_tree_node* h_tree_cat(struct h_arena* arena, struct h_tree_node* left, struct h_tree_node* right)
+{
+	struct h_tree_node* child_left;
+	struct h_tree_node* child_right;
+
+	if (left == NULL)
+		return right;
+
+	if (right == NULL)
+		return left;
+
+	if (left->height > right->height + 1) {
+		take_children(left, &child_left, &child_right);
+
+		return balance(arena, child_left, h_tree_cat(arena, child_right, right));
+	}
+
+	if (right->height > left->height + 1) {
+		take_children(right, &child_left, &child_right);
+
+		return balance(arena, h_tree_cat(arena, left, child_left), child_right);
+	}
+
+	if (left->height == 0 && right->height == 0 && left->count + right->count <= H_TREE_LEAF_SIZE)
+		return merge_leaves(arena, left, right);
+
+	return create_branch(arena, left, right);
+}
+
+size_t h_tree_count(const struct h_tree_node* node)
+{
+	return node != NULL ? node->count : 0;
+}
+
+struct h_value h_tree_get(const struct h_tree_node* node, size_t index)
+{
+	while (node->height > 0) {
+		if (index < node->left->count) {
+			node = node->left;
+		} else {
+			index -= node->left->count;
+			node   = node->right;
+		}
+	}
+
+	return node->values[index];
+}
+
+struct h_tree_node* h_tree_set(struct h_arena* arena, struct h_tree_node* node, size_t index,
+		struct h_value value)
+{
+	node = unique(arena, node);
+
+	if (node->height == 0) {
+		h_value_release(&node->values[index]);
+		node->values[index] = value;
+	} else if (index < node->left->count) {
+		node->left = h_tree_set(arena, node->left, index, value);
+	} else {
+		node->right = h_tree_set(arena, node->right, index - node->left->count, value);
+	}
+
+	return node;
+}
+
+struct h_tree_node* h_tree_push(struct h_arena* arena, struct h_tree_node* node, struct h_value value)
+{
+	struct h_tree_node* leaf = create_leaf(arena);
+
+	leaf->values[0] = value;
+	leaf->count     = 1;
+
+	return h_tree_cat(arena, node, leaf);
+}
+
+struct h_tree_node* h_tree_pop(struct h_arena* arena, struct h_tree_node* node, struct h_value* value)
+{
+	struct h_tree_node* left;
+	struct h_tree_node* right;
+
+	if (node->height > 0) {
+		take_children(node, &left, &right);
+
+		return h_tree_cat(arena, left, h_tree_pop(arena, right, value));
+	}
+
+	node   = unique(arena, node);
+	*value = node->values[--node->count];
+
+	if (node->count > 0)
+		return node;
+
+	h_tree_release(node);
+
+	return NULL;
+}
@@ -11,75 +11,184 @@
 	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include <stdarg.h>
 #include <stdio.h>
 
 #include "h.h"
 
-#define MAX_ARRAY_VALUE_SIZE 256
+#define MIN_STRING_CAPACITY 256
 
-void h_value_to_string_buf(const struct h_value* value, char* buf, size_t buf_size)
+struct writer {
+	char* buf;
+	size_t buf_size;
+	size_t lenght;
+	bool growable;
+};
+
+static char* writer_tail(const struct writer* writer)
+{
+	return writer->lenght < writer->buf_size ? writer->buf + writer->lenght : NULL;
+}
+
+static size_t writer_space(const struct writer* writer)
+{
+	return writer->lenght < writer->buf_size ? writer->buf_size - writer->lenght : 0;
+}
+
+static void writer_reserve(struct writer* writer, size_t lenght)
+{
+	if (!writer->growable || writer->lenght + lenght < writer->buf_size)
+		return;
+
+	size_t buf_size = writer->buf_size * 2;
+	if (buf_size <= writer->lenght + lenght)
+		buf_size = writer->lenght + lenght + 1;
+
+	writer->buf      = realloc(writer->buf, buf_size);
+	writer->buf_size = buf_size;
+}
+
+static void write_format(struct writer* writer, const char* format, ...)
 {
-	char array_buf[MAX_ARRAY_VALUE_SIZE];
+	va_list args;
+	va_list retry_args;
 
-	switch (value->type) {
+	va_start(args, format);
+	va_copy(retry_args, args);
+
+	int lenght = vsnprintf(writer_tail(writer), writer_space(writer), format, args);
+
+	if (writer->growable && writer->lenght + lenght >= writer->buf_size) {
+		writer_reserve(writer, lenght);
+		vsnprintf(writer_tail(writer), writer_space(writer), format, retry_args);
+	}
+
+	writer->lenght += lenght;
+
+	va_end(retry_args);
+	va_end(args);
+}
+
+static void write_value(struct writer* writer, const struct h_value* value)
+{
+	const struct h_array* array;
+	struct h_value element;
+	enum h_array_kind kind;
+	size_t stride;
+	const char* bytes;
+
+	switch (h_value_get_type(value)) {
 	case H_NUMBER:
-		if (cimag(value->value.number) != 0) {
-			snprintf(buf, buf_size, "%g + i%g", creal(value->value.number),
-					cimag(value->value.number));
+		if (h_value_get_number_kind(value) == H_NUMBER_BIG) {
+			writer_reserve(writer, h_value_get_bignum(value)->count * 10 + 2);
+			writer->lenght += h_bignum_to_string(h_value_get_bignum(value), writer_tail(writer),
+					writer_space(writer));
+			break;
+		}
+
+		if (cimag(h_value_get_number(value)) != 0) {
+			write_format(writer, "%g + i%g", creal(h_value_get_number(value)),
+					cimag(h_value_get_number(value)));
 			break;
 		}
 
-		snprintf(buf, buf_size, "%g", creal(value->value.number));
+		write_format(writer, "%g", creal(h_value_get_number(value)));
 
 		break;
 
 	case H_FUNCTION:
-		snprintf(buf, buf_size, "<function at %p>", &value->value.function);
+		write_format(writer, "<function at %p>", h_value_get_function(value));
 		break;
 
 	case H_CHAR:
-		snprintf(buf, buf_size, "%c", value->value.charester);
+		write_format(writer, "%c", h_value_get_char(value));
 		break;
 
 	case H_ARRAY:
-		if (h_is_array_string(&value->value.array)) {
-			buf += snprintf(buf, buf_size, "\"");
+		array = h_value_get_array(value);
+		bytes = h_array_data(array, &kind, &stride);
+
+		if (kind == H_ARRAY_BYTES && stride == 1) {
+			writer_reserve(writer, h_array_count(array) + 2);
+			write_format(writer, "\"%.*s\"", (int) h_array_count(array), bytes);
+
+			break;
+		}
+
+		if (h_array_is_string(array)) {
+			write_format(writer, "\"");
 
-			for (int i = 0; i < value->value.array.count; i++) {
-				buf += snprintf(buf, buf_size, "%c",
-						value->value.array.value[i].value.charester);
+			for (size_t i = 0; i < h_array_count(array); i++) {
+				element = h_array_get(array, i);
+				write_format(writer, "%c", h_value_get_char(&element));
 			}
 
-			buf += snprintf(buf, buf_size, "\"");
+			write_format(writer, "\"");
 
 			break;
 		}
 
-		buf += snprintf(buf, buf_size, "[");
+		write_format(writer, "[");
 
-		for (int i = value->value.array.count - 1; i >= 0; i--) {
-			h_value_to_string_buf(&value->value.array.value[i], array_buf, sizeof(array_buf));
-			buf += snprintf(buf, buf_size, "%s ", array_buf);
+		for (size_t i = h_array_count(array); i > 0; i--) {
+			element = h_array_get(array, i - 1);
+			write_value(writer, &element);
+			write_format(writer, " ");
 		}
 
-		buf += snprintf(buf, buf_size, "]");
+		write_format(writer, "]");
 	}
 }
 
-void h_value_stack_to_string_buf(const struct h_value_stack* stack, char* buf, size_t buf_size)
+size_t h_value_to_string_buf(const struct h_value* value, char* buf, size_t buf_size)
 {
-	char value_buf[MAX_ARRAY_VALUE_SIZE];
+	struct writer writer = { .buf = buf, .buf_size = buf_size };
 
-	for (int i = 0; i < stack->count; i++) {
-		h_value_to_string_buf(&stack->value[i], value_buf, sizeof(value_buf));
-		buf += snprintf(buf, buf_size, "%s\n", value_buf);
+	if (buf_size > 0)
+		buf[0] = '\0';
+
+	write_value(&writer, value);
+
+	return writer.lenght;
+}
+
+static void write_stack(struct writer* writer, const struct h_value_stack* stack)
+{
+	if (writer->buf_size > 0)
+		writer->buf[0] = '\0';
+
+	for (size_t i = 0; i < stack->count; i++) {
+		write_value(writer, &stack->value[i]);
+		write_format(writer, "\n");
 	}
 }
 
+size_t h_value_stack_to_string_buf(const struct h_value_stack* stack, char* buf, size_t buf_size)
+{
+	struct writer writer = { .buf = buf, .buf_size = buf_size };
+
+	write_stack(&writer, stack);
+
+	return writer.lenght;
+}
+
+char* h_value_stack_to_string(const struct h_value_stack* stack)
+{
+	struct writer writer = {
+		.buf      = malloc(MIN_STRING_CAPACITY),
+		.buf_size = MIN_STRING_CAPACITY,
+		.growable = true,
+	};
+
+	write_stack(&writer, stack);
+
+	return writer.buf;
+}
+
 bool h_is_array_string(const struct h_value_stack* stack)
 {
 	for (int i = 0; i < stack->count; i++) {
-		if (stack->value[i].type != H_CHAR)
+		if (h_value_get_type(&stack->value[i]) != H_CHAR)
 			return false;
 	}
 
@@ -0,0 +1,94 @@
+/*
+	Permission to use, copy, modify, and/or distribute this software for
+	any purpose with or without fee is hereby granted.
+
+	THE SOFTWARE IS PROVIDED “AS IS” AND THE AUTHOR DISCLAIMS ALL
+	WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+	FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+	DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+	AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "h.h"
+
+static void* allocate(struct h_arena* arena, size_t size)
+{
+	return arena != NULL ? h_arena_alloc(arena, size) : malloc(size);
+}
+
+struct h_function* h_function_create(struct h_arena* arena, struct h_program* program, size_t offset,
+		size_t count)
+{
+	struct h_function* function = allocate(arena, sizeof(struct h_function));
+
+	*function = (struct h_function) {
+		.ref_count = 1,
+		.arena     = arena,
+		.program   = program,
+		.offset    = offset,
+		.count     = count,
+	};
+
+	h_program_retain(program);
+
+	return function;
+}
+
+void h_value_retain(const struct h_value* value)
+{
+	switch (h_value_get_type(value)) {
+	case H_NUMBER:
+		if (h_value_get_number_kind(value) == H_NUMBER_BIG)
+			h_bignum_retain(h_value_get_bignum(value));
+
+		break;
+
+	case H_FUNCTION:
+		__atomic_fetch_add(&h_value_get_function(value)->ref_count, 1, __ATOMIC_RELAXED);
+		break;
+
+	case H_ARRAY:
+		__atomic_fetch_add(&h_value_get_array(value)->ref_count, 1, __ATOMIC_RELAXED);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void h_value_release(struct h_value* value)
+{
+	switch (h_value_get_type(value)) {
+	case H_NUMBER:
+		if (h_value_get_number_kind(value) == H_NUMBER_BIG)
+			h_bignum_release(h_value_get_bignum(value));
+
+		break;
+
+	case H_FUNCTION: {
+		struct h_function* function = h_value_get_function(value);
+
+		if (__atomic_sub_fetch(&function->ref_count, 1, __ATOMIC_ACQ_REL) != 0 || function->arena != NULL)
+			break;
+
+		h_program_release(function->program);
+		free(function);
+
+		break;
+	}
+
+	case H_ARRAY: {
+		struct h_array* array = h_value_get_array(value);
+
+		if (__atomic_sub_fetch(&array->ref_count, 1, __ATOMIC_ACQ_REL) == 0)
+			h_array_free(array);
+
+		break;
+	}
+
+	default:
+		break;
+	}
+}
@@ -15,341 +15,1201 @@
 #include <stdbool.h>
 #include <complex.h>
 #include <string.h>
+#include <math.h>
 
 #include "h.h"
 
 #define continue_or_return_if_error(x) ({ struct h_error __x = (x); if (__x.type != H_OK) return __x; })
 #define continue_or_return_if_pop_error(x) if (x.error.type != H_OK) return x.error;
-#define continue_or_return_if_type_error(x, y, src) if (x.type != y) return (struct h_error) { \
+#define continue_or_return_if_type_error(x, y) if (h_value_get_type(&x) != y) return (struct h_error) { \
 			.type = H_ERROR_TYPE_ERROR, \
-			.source = src, \
 			.value.type_error.excepted = y, \
-			.value.type_error.got = x.type, \
+			.value.type_error.got = h_value_get_type(&x), \
+		};
+
+#define continue_or_return_if_too_short(x, n) if (h_array_count(x) < n) return (struct h_error) { \
+			.type = H_ERROR_EMPTY_STACK, \
 		};
 
 #define return_ok() return (struct h_error) { .type = H_OK }
 
-static struct h_error execute_instr(const struct h_instr* instr, struct h_runtime* runtime);
+#define array_lenght(x) sizeof(x) / sizeof(x[0])
 
-struct h_error h_execute_instr_stack(const struct h_instr_stack* instr_stack, struct h_runtime* runtime)
+#if defined(__GNUC__) && !defined(H_SWITCH_DISPATCH)
+#define H_THREADED_DISPATCH
+#endif
+
+void h_create_runtime(struct h_runtime* runtime, struct h_arena* arena)
+{
+	*runtime = (struct h_runtime) {
+		.sumboil_stack = { .arena = arena },
+		.value_stack   = { .arena = arena },
+		.arena         = arena,
+	};
+}
+
+void h_free_runtime(struct h_runtime* runtime)
+{
+	h_value_stack_free(&runtime->value_stack);
+	h_sumboil_stack_free(&runtime->sumboil_stack);
+}
+
+struct h_value* h_runtime_lookup(const struct h_runtime* runtime, const char* name)
+{
+	uint32_t slot;
+	if (!h_find_symbol(name, &slot))
+		return NULL;
+
+	return h_sumboil_stack_get(&runtime->sumboil_stack, slot);
+}
+
+void h_runtime_define(struct h_runtime* runtime, const char* name, struct h_value value)
+{
+	h_sumboil_stack_set(&runtime->sumboil_stack, h_intern(name), value);
+}
+
+static inline struct h_value_stack_pop_result pop_operand(const struct h_op* op, struct h_value_stack* stack)
+{
+	if (!(h_op_flags(op) & H_OP_VERIFIED))
+		return h_value_stack_pop(stack);
+
+	return (struct h_value_stack_pop_result) {
+		.value = stack->value[--stack->count],
+		.error = (struct h_error) { .type = H_OK },
+	};
+}
+
+static struct h_error execute_code(const struct h_program* program, const struct h_op* op,
+		const struct h_op* end, struct h_runtime* runtime);
+static struct h_error execute_const(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_number_op(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	for (int i = 0; i < instr_stack->count; i++) {
-		const struct h_instr* instr = &instr_stack->instrs[i];
+	struct h_value_stack* stack = &runtime->value_stack;
+	struct h_value* value0      = &stack->value[stack->count - 1];
+	struct h_value* value1      = &stack->value[stack->count - 2];
+	struct h_value result_value;
+	int order;
+
+	switch (op->operand) {
+	case H_ADD: result_value = h_number_add(value0, value1); break;
+	case H_SUB: result_value = h_number_sub(value0, value1); break;
+	case H_MUL: result_value = h_number_mul(value0, value1); break;
+	case H_POW: result_value = h_number_pow(value1, value0); break;
+
+	case H_DIV:
+		if (!h_number_is_true(value1))
+			return (struct h_error) { .type = H_ERROR_DIVISON_BY_ZERO };
+
+		result_value = h_number_div(value0, value1);
+		break;
+
+	case H_EQUALS: result_value = h_make_integer(h_number_equals(value0, value1)); break;
+	case H_NOT_EQUALS: result_value = h_make_integer(!h_number_equals(value0, value1)); break;
+	case H_MORE: result_value = h_make_integer(h_number_compare(value0, value1) == 1); break;
+	case H_LESS: result_value = h_make_integer(h_number_compare(value0, value1) == -1); break;
 
-		continue_or_return_if_error(execute_instr(instr, runtime));
+	case H_MORE_OR_EQUALS:
+		order        = h_number_compare(value0, value1);
+		result_value = h_make_integer(order == 0 || order == 1);
+		break;
+
+	case H_LESS_OR_EQUALS:
+		order        = h_number_compare(value0, value1);
+		result_value = h_make_integer(order == 0 || order == -1);
+		break;
+	case H_AND: result_value = h_make_integer(h_number_is_true(value0) && h_number_is_true(value1)); break;
+	case H_OR: result_value = h_make_integer(h_number_is_true(value0) || h_number_is_true(value1)); break;
+
+	default:
+		return (struct h_error) { .type = H_ERROR_UNDEFINED_VM_INSTRUCTION };
 	}
 
+	h_value_release(value0);
+	h_value_release(value1);
+
+	*value1 = result_value;
+	stack->count--;
+
 	return_ok();
 }
 
-static struct h_error execute_value(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_add(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_sub(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_mul(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_div(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_array_def(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_imaginarity_const(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_pop(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_flip(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_copy(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_arr_get(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_arr_push(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_arr_pop(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_arr_flip(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_arr_copy(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_arr_cat(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_equals(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_not_equals(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_more(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_less(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_more_or_equals(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_less_or_equals(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_and(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_or(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_not(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_reduce(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_enumerate(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_range(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_create_variable(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_variable(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_real(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_imag(const struct h_instr* instr, struct h_runtime* runtime);
-static struct h_error execute_pow(const struct h_instr* instr, struct h_runtime* runtime);
-
-static struct h_error execute_instr(const struct h_instr* instr, struct h_runtime* runtime)
-{
-	switch (instr->type) {
-	case H_VALUE:
-		continue_or_return_if_error(execute_value(instr, runtime));
+static struct h_error execute_array_def(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_function_def(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_add(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_sub(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_mul(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_div(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_imaginarity_const(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_pop(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_flip(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_copy(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_arr_get(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_arr_push(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_arr_pop(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_arr_flip(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_arr_copy(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_arr_cat(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_arr_take(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_arr_drop(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_arr_step(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_equals(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_not_equals(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_more(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_less(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_more_or_equals(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_less_or_equals(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_and(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_or(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_not(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_reduce(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_enumerate(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_range(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_create_variable(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_variable(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_real(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_imag(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_pow(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_fused(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_number_op(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_quickened(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+static struct h_error execute_call_function(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime);
+
+static struct h_error (*const executors[H_INSTR_TYPE_COUNT])(const struct h_program*, const struct h_op*,
+		struct h_runtime*) = {
+	[H_CONST]             = execute_const,
+	[H_ADD]               = execute_add,
+	[H_SUB]               = execute_sub,
+	[H_MUL]               = execute_mul,
+	[H_DIV]               = execute_div,
+	[H_POW]               = execute_pow,
+	[H_REAL]              = execute_real,
+	[H_IMAG]              = execute_imag,
+	[H_IMAGINARITY_CONST] = execute_imaginarity_const,
+	[H_POP]               = execute_pop,
+	[H_FLIP]              = execute_flip,
+	[H_COPY]              = execute_copy,
+	[H_ARR_PUSH]          = execute_arr_push,
+	[H_ARR_GET]           = execute_arr_get,
+	[H_ARR_POP]           = execute_arr_pop,
+	[H_ARR_FLIP]          = execute_arr_flip,
+	[H_ARR_COPY]          = execute_arr_copy,
+	[H_ARR_CAT]           = execute_arr_cat,
+	[H_ARR_TAKE]          = execute_arr_take,
+	[H_ARR_DROP]          = execute_arr_drop,
+	[H_ARR_STEP]          = execute_arr_step,
+	[H_EQUALS]            = execute_equals,
+	[H_NOT_EQUALS]        = execute_not_equals,
+	[H_MORE]              = execute_more,
+	[H_LESS]              = execute_less,
+	[H_MORE_OR_EQUALS]    = execute_more_or_equals,
+	[H_LESS_OR_EQUALS]    = execute_less_or_equals,
+	[H_AND]               = execute_and,
+	[H_OR]                = execute_or,
+	[H_NOT]               = execute_not,
+	[H_REDUCE]            = execute_reduce,
+	[H_ENUMERATE]         = execute_enumerate,
+	[H_RANGE]             = execute_range,
+	[H_LOAD_LIBRARY]      = NULL,
+	[H_LOAD_VARIABLE]     = NULL,
+	[H_CREATE_VARIABLE]   = execute_create_variable,
+	[H_CALL_SUMBOIL]      = execute_variable,
+	[H_CONST_CONST]       = execute_fused,
+	[H_COPY_MUL]          = execute_fused,
+	[H_CONST_RANGE]       = execute_fused,
+	[H_CONST_POW]         = execute_fused,
+	[H_CONST_ADD]         = execute_fused,
+	[H_CONST_SUB]         = execute_fused,
+	[H_CONST_MUL]         = execute_fused,
+	[H_CONST_DIV]         = execute_fused,
+	[H_NUMBER_OP]         = execute_number_op,
+	[H_ADD_INTEGERS]      = execute_quickened,
+	[H_SUB_INTEGERS]      = execute_quickened,
+	[H_MUL_INTEGERS]      = execute_quickened,
+	[H_DIV_INTEGERS]      = execute_quickened,
+	[H_EQUALS_INTEGERS]   = execute_quickened,
+	[H_MORE_INTEGERS]     = execute_quickened,
+	[H_LESS_INTEGERS]     = execute_quickened,
+	[H_ADD_REALS]         = execute_quickened,
+	[H_SUB_REALS]         = execute_quickened,
+	[H_MUL_REALS]         = execute_quickened,
+	[H_DIV_REALS]         = execute_quickened,
+	[H_EQUALS_REALS]      = execute_quickened,
+	[H_MORE_REALS]        = execute_quickened,
+	[H_LESS_REALS]        = execute_quickened,
+	[H_CALL_FUNCTION]     = execute_call_function,
+};
+
+static struct h_error execute_fused(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
+{
+	const struct h_fusion* fusion = &h_fusions[op->type];
+
+	struct h_op first  = { .type = fusion->first, .flags = op->flags, .operand = op->operand };
+	struct h_op second = { .type = fusion->second, .flags = op->flags,
+		.operand = op->operand + h_op_operands(fusion->first) };
+
+	continue_or_return_if_error(executors[first.type](program, &first, runtime));
+
+	return executors[second.type](program, &second, runtime);
+}
+
+static bool is_quickenable(enum h_instr_type type)
+{
+	switch (type) {
+	case H_ADD:
+	case H_SUB:
+	case H_MUL:
+	case H_DIV:
+	case H_EQUALS:
+	case H_MORE:
+	case H_LESS:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+static void rewrite_op(const struct h_program* program, const struct h_op* op, enum h_instr_type type)
+{
+	uint8_t generic = h_quickenings[type].generic;
+
+	if (__atomic_compare_exchange_n(&((struct h_op*) op)->type, &generic, type, false, __ATOMIC_RELAXED,
+				__ATOMIC_RELAXED))
+		__atomic_fetch_add(&((struct h_program*) program)->quickened, 1, __ATOMIC_RELAXED);
+}
+
+static void deoptimize(const struct h_op* op, enum h_instr_type type)
+{
+	__atomic_fetch_or(&((struct h_op*) op)->flags, H_OP_DEOPTIMIZED, __ATOMIC_RELAXED);
+	__atomic_store_n(&((struct h_op*) op)->type, h_op_generic(type), __ATOMIC_RELAXED);
+}
+
+static void quicken(const struct h_program* program, const struct h_op* op, const struct h_value_stack* stack)
+{
+	enum h_instr_type type = h_op_type(op);
+
+	if (!is_quickenable(type))
+		return;
+
+	if (stack->count >= 2) {
+		const struct h_value* value0 = &stack->value[stack->count - 1];
+		const struct h_value* value1 = &stack->value[stack->count - 2];
+		enum h_number_kind kind      = h_value_get_number_kind(value0);
+
+		if (h_value_get_type(value0) == H_NUMBER && h_value_get_type(value1) == H_NUMBER
+				&& h_value_get_number_kind(value1) == kind)
+			for (size_t quickened = H_NUMBER_OP + 1; quickened < H_INSTR_TYPE_COUNT; quickened++)
+				if (h_quickenings[quickened].generic == type && h_quickenings[quickened].kind == kind) {
+					rewrite_op(program, op, quickened);
+					return;
+				}
+	}
+
+	__atomic_fetch_or(&((struct h_op*) op)->flags, H_OP_DEOPTIMIZED, __ATOMIC_RELAXED);
+}
+
+static inline bool execute_specialized(const struct h_op* op, enum h_instr_type type, struct h_value_stack* stack)
+{
+	if (!(h_op_flags(op) & H_OP_VERIFIED) && stack->count < 2)
+		return false;
+
+	struct h_value* value0 = &stack->value[stack->count - 1];
+	struct h_value* value1 = &stack->value[stack->count - 2];
+	enum h_number_kind kind = h_quickenings[type].kind;
+
+	if (h_value_get_type(value0) != H_NUMBER || h_value_get_type(value1) != H_NUMBER
+			|| h_value_get_number_kind(value0) != kind || h_value_get_number_kind(value1) != kind) {
+		deoptimize(op, type);
+		return false;
+	}
+
+	if (kind == H_NUMBER_REAL) {
+		double real0 = h_value_get_real(value0);
+		double real1 = h_value_get_real(value1);
+
+		switch (type) {
+		case H_ADD_REALS:    *value1 = h_make_real(real0 + real1); break;
+		case H_SUB_REALS:    *value1 = h_make_real(real0 - real1); break;
+		case H_MUL_REALS:    *value1 = h_make_real(real0 * real1); break;
+		case H_EQUALS_REALS: *value1 = h_make_integer(real0 == real1); break;
+		case H_MORE_REALS:   *value1 = h_make_integer(real0 > real1); break;
+		case H_LESS_REALS:   *value1 = h_make_integer(real0 < real1); break;
+		default:
+			if (real1 == 0)
+				return false;
+
+			*value1 = h_make_real(real0 / real1);
+			break;
+		}
+	} else {
+		int64_t integer0 = h_value_get_integer(value0);
+		int64_t integer1 = h_value_get_integer(value1);
+		int64_t result;
+
+		switch (type) {
+		case H_ADD_INTEGERS:    result = integer0 + integer1; break;
+		case H_SUB_INTEGERS:    result = integer0 - integer1; break;
+		case H_EQUALS_INTEGERS: result = integer0 == integer1; break;
+		case H_MORE_INTEGERS:   result = integer0 > integer1; break;
+		case H_LESS_INTEGERS:   result = integer0 < integer1; break;
+		case H_MUL_INTEGERS:
+			if (__builtin_mul_overflow(integer0, integer1, &result) || result == 0)
+				return false;
+
+			break;
+
+		default:
+			if (integer1 == 0 || integer0 == 0 || integer0 % integer1 != 0)
+				return false;
+
+			result = integer0 / integer1;
+			break;
+		}
+
+		if (result < -H_MAX_EXACT_INTEGER || result > H_MAX_EXACT_INTEGER)
+			return false;
+
+		*value1 = h_make_integer(result);
+	}
+
+	stack->count--;
+
+	return true;
+}
+
+static struct h_error execute_quickened(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
+{
+	enum h_instr_type type = h_op_type(op);
+
+	if (execute_specialized(op, type, &runtime->value_stack))
+		return_ok();
+
+	return executors[h_op_generic(type)](program, op, runtime);
+}
+
+static struct h_error locate_error(const struct h_program* program, const struct h_op* op, struct h_error error)
+{
+	if (error.source.source_type == H_ERROR_SOURCE_NONE)
+		error.source = h_program_source(program, op - program->code.ops);
+
+	return error;
+}
+
+#ifdef H_PROFILE_OPS
+struct op_pair {
+	size_t count;
+	enum h_instr_type first;
+	enum h_instr_type second;
+};
+
+static size_t op_pairs[H_INSTR_TYPE_COUNT][H_INSTR_TYPE_COUNT];
+
+static const char* const op_names[H_INSTR_TYPE_COUNT] = {
+	[H_VALUE]             = "H_VALUE",
+	[H_CONST]             = "H_CONST",
+	[H_ADD]               = "H_ADD",
+	[H_SUB]               = "H_SUB",
+	[H_MUL]               = "H_MUL",
+	[H_DIV]               = "H_DIV",
+	[H_POW]               = "H_POW",
+	[H_REAL]              = "H_REAL",
+	[H_IMAG]              = "H_IMAG",
+	[H_IMAGINARITY_CONST] = "H_IMAGINARITY_CONST",
+	[H_POP]               = "H_POP",
+	[H_FLIP]              = "H_FLIP",
+	[H_COPY]              = "H_COPY",
+	[H_ARRAY_DEF]         = "H_ARRAY_DEF",
+	[H_FUNCTION_DEF]      = "H_FUNCTION_DEF",
+	[H_ARR_PUSH]          = "H_ARR_PUSH",
+	[H_ARR_GET]           = "H_ARR_GET",
+	[H_ARR_POP]           = "H_ARR_POP",
+	[H_ARR_FLIP]          = "H_ARR_FLIP",
+	[H_ARR_COPY]          = "H_ARR_COPY",
+	[H_ARR_CAT]           = "H_ARR_CAT",
+	[H_ARR_TAKE]          = "H_ARR_TAKE",
+	[H_ARR_DROP]          = "H_ARR_DROP",
+	[H_ARR_STEP]          = "H_ARR_STEP",
+	[H_EQUALS]            = "H_EQUALS",
+	[H_NOT_EQUALS]        = "H_NOT_EQUALS",
+	[H_MORE]              = "H_MORE",
+	[H_LESS]              = "H_LESS",
+	[H_MORE_OR_EQUALS]    = "H_MORE_OR_EQUALS",
+	[H_LESS_OR_EQUALS]    = "H_LESS_OR_EQUALS",
+	[H_AND]               = "H_AND",
+	[H_OR]                = "H_OR",
+	[H_NOT]               = "H_NOT",
+	[H_REDUCE]            = "H_REDUCE",
+	[H_ENUMERATE]         = "H_ENUMERATE",
+	[H_RANGE]             = "H_RANGE",
+	[H_LOAD_LIBRARY]      = "H_LOAD_LIBRARY",
+	[H_LOAD_VARIABLE]     = "H_LOAD_VARIABLE",
+	[H_CREATE_VARIABLE]   = "H_CREATE_VARIABLE",
+	[H_CALL_SUMBOIL]      = "H_CALL_SUMBOIL",
+	[H_CONST_CONST]       = "H_CONST_CONST",
+	[H_COPY_MUL]          = "H_COPY_MUL",
+	[H_CONST_RANGE]       = "H_CONST_RANGE",
+	[H_CONST_POW]         = "H_CONST_POW",
+	[H_CONST_ADD]         = "H_CONST_ADD",
+	[H_CONST_SUB]         = "H_CONST_SUB",
+	[H_CONST_MUL]         = "H_CONST_MUL",
+	[H_CONST_DIV]         = "H_CONST_DIV",
+	[H_NUMBER_OP]         = "H_NUMBER_OP",
+	[H_ADD_INTEGERS]      = "H_ADD_INTEGERS",
+	[H_SUB_INTEGERS]      = "H_SUB_INTEGERS",
+	[H_MUL_INTEGERS]      = "H_MUL_INTEGERS",
+	[H_DIV_INTEGERS]      = "H_DIV_INTEGERS",
+	[H_EQUALS_INTEGERS]   = "H_EQUALS_INTEGERS",
+	[H_MORE_INTEGERS]     = "H_MORE_INTEGERS",
+	[H_LESS_INTEGERS]     = "H_LESS_INTEGERS",
+	[H_ADD_REALS]         = "H_ADD_REALS",
+	[H_SUB_REALS]         = "H_SUB_REALS",
+	[H_MUL_REALS]         = "H_MUL_REALS",
+	[H_DIV_REALS]         = "H_DIV_REALS",
+	[H_EQUALS_REALS]      = "H_EQUALS_REALS",
+	[H_MORE_REALS]        = "H_MORE_REALS",
+	[H_LESS_REALS]        = "H_LESS_REALS",
+	[H_CALL_FUNCTION]     = "H_CALL_FUNCTION",
+};
+
+static void profile_op(enum h_instr_type* previous, enum h_instr_type type)
+{
+	if (*previous != H_VALUE)
+		op_pairs[*previous][type]++;
+
+	*previous = type;
+}
+
+static int compare_op_pairs(const void* a, const void* b)
+{
+	const struct op_pair* pair0 = a;
+	const struct op_pair* pair1 = b;
+
+	return (pair0->count < pair1->count) - (pair0->count > pair1->count);
+}
+
+void h_write_op_profile(FILE* stream, size_t limit)
+{
+	struct op_pair* pairs = malloc(H_INSTR_TYPE_COUNT * H_INSTR_TYPE_COUNT * sizeof(struct op_pair));
+	size_t count          = 0;
+
+	for (size_t i = 0; i < H_INSTR_TYPE_COUNT; i++)
+		for (size_t j = 0; j < H_INSTR_TYPE_COUNT; j++)
+			if (op_pairs[i][j] != 0)
+				pairs[count++] = (struct op_pair) { op_pairs[i][j], i, j };
+
+	qsort(pairs, count, sizeof(struct op_pair), compare_op_pairs);
+
+	for (size_t i = 0; i < count && i < limit; i++)
+		fprintf(stream, "%12zu  %s %s\n", pairs[i].count, op_names[pairs[i].first],
+				op_names[pairs[i].second]);
+
+	free(pairs);
+}
+#endif
+
+#ifndef H_THREADED_DISPATCH
+static struct h_error execute_instr(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
+{
+	switch (h_op_type(op)) {
+	case H_CONST:
+		continue_or_return_if_error(execute_const(program, op, runtime));
+		break;
+
+	case H_ARRAY_DEF:
+		continue_or_return_if_error(execute_array_def(program, op, runtime));
+		break;
+
+	case H_FUNCTION_DEF:
+		continue_or_return_if_error(execute_function_def(program, op, runtime));
 		break;
 
 	case H_ADD:
-		continue_or_return_if_error(execute_add(instr, runtime));
+		continue_or_return_if_error(execute_add(program, op, runtime));
 		break;
 
 	case H_SUB:
-		continue_or_return_if_error(execute_sub(instr, runtime));
+		continue_or_return_if_error(execute_sub(program, op, runtime));
 		break;
 
 	case H_MUL:
-		continue_or_return_if_error(execute_mul(instr, runtime));
+		continue_or_return_if_error(execute_mul(program, op, runtime));
 		break;
 
 	case H_DIV:
-		continue_or_return_if_error(execute_div(instr, runtime));
-		break;
-
-	case H_ARRAY_DEF:
-		continue_or_return_if_error(execute_array_def(instr, runtime));
+		continue_or_return_if_error(execute_div(program, op, runtime));
 		break;
 
 	case H_IMAGINARITY_CONST:
-		continue_or_return_if_error(execute_imaginarity_const(instr, runtime));
+		continue_or_return_if_error(execute_imaginarity_const(program, op, runtime));
 		break;
 
 	case H_POP:
-		continue_or_return_if_error(execute_pop(instr, runtime));
+		continue_or_return_if_error(execute_pop(program, op, runtime));
 		break;
 
 	case H_FLIP:
-		continue_or_return_if_error(execute_flip(instr, runtime));
+		continue_or_return_if_error(execute_flip(program, op, runtime));
 		break;
 
 	case H_COPY:
-		continue_or_return_if_error(execute_copy(instr, runtime));
+		continue_or_return_if_error(execute_copy(program, op, runtime));
 		break;
 
 	case H_ARR_GET:
-		continue_or_return_if_error(execute_arr_get(instr, runtime));
+		continue_or_return_if_error(execute_arr_get(program, op, runtime));
 		break;
 
 	case H_ARR_PUSH:
-		continue_or_return_if_error(execute_arr_push(instr, runtime));
+		continue_or_return_if_error(execute_arr_push(program, op, runtime));
 		break;
 
 	case H_ARR_POP:
-		continue_or_return_if_error(execute_arr_pop(instr, runtime));
+		continue_or_return_if_error(execute_arr_pop(program, op, runtime));
 		break;
 
 	case H_ARR_FLIP:
-		continue_or_return_if_error(execute_arr_flip(instr, runtime));
+		continue_or_return_if_error(execute_arr_flip(program, op, runtime));
 		break;
 
 	case H_ARR_COPY:
-		continue_or_return_if_error(execute_arr_copy(instr, runtime));
+		continue_or_return_if_error(execute_arr_copy(program, op, runtime));
 		break;
 
 	case H_ARR_CAT:
-		continue_or_return_if_error(execute_arr_cat(instr, runtime));
+		continue_or_return_if_error(execute_arr_cat(program, op, runtime));
+		break;
+
+	case H_ARR_TAKE:
+		continue_or_return_if_error(execute_arr_take(program, op, runtime));
+		break;
+
+	case H_ARR_DROP:
+		continue_or_return_if_error(execute_arr_drop(program, op, runtime));
+		break;
+
+	case H_ARR_STEP:
+		continue_or_return_if_error(execute_arr_step(program, op, runtime));
 		break;
 
 	case H_EQUALS:
-		continue_or_return_if_error(execute_equals(instr, runtime));
+		continue_or_return_if_error(execute_equals(program, op, runtime));
 		break;
 
 	case H_NOT_EQUALS:
-		continue_or_return_if_error(execute_not_equals(instr, runtime));
+		continue_or_return_if_error(execute_not_equals(program, op, runtime));
 		break;
 
 	case H_MORE:
-		continue_or_return_if_error(execute_more(instr, runtime));
+		continue_or_return_if_error(execute_more(program, op, runtime));
 		break;
 
 	case H_LESS:
-		continue_or_return_if_error(execute_less(instr, runtime));
+		continue_or_return_if_error(execute_less(program, op, runtime));
 		break;
 
 	case H_MORE_OR_EQUALS:
-		continue_or_return_if_error(execute_more_or_equals(instr, runtime));
+		continue_or_return_if_error(execute_more_or_equals(program, op, runtime));
 		break;
 
 	case H_LESS_OR_EQUALS:
-		continue_or_return_if_error(execute_less_or_equals(instr, runtime));
+		continue_or_return_if_error(execute_less_or_equals(program, op, runtime));
 		break;
 
 	case H_AND:
-		continue_or_return_if_error(execute_and(instr, runtime));
+		continue_or_return_if_error(execute_and(program, op, runtime));
 		break;
 
 	case H_OR:
-		continue_or_return_if_error(execute_or(instr, runtime));
+		continue_or_return_if_error(execute_or(program, op, runtime));
 		break;
 
 	case H_NOT:
-		continue_or_return_if_error(execute_not(instr, runtime));
+		continue_or_return_if_error(execute_not(program, op, runtime));
 		break;
 
 	case H_REDUCE:
-		continue_or_return_if_error(execute_reduce(instr, runtime));
+		continue_or_return_if_error(execute_reduce(program, op, runtime));
 		break;
 
 	case H_ENUMERATE:
-		continue_or_return_if_error(execute_enumerate(instr, runtime));
+		continue_or_return_if_error(execute_enumerate(program, op, runtime));
 		break;
 
 	case H_RANGE:
-		continue_or_return_if_error(execute_range(instr, runtime));
+		continue_or_return_if_error(execute_range(program, op, runtime));
 		break;
 
 	case H_CREATE_VARIABLE:
-		continue_or_return_if_error(execute_create_variable(instr, runtime));
+		continue_or_return_if_error(execute_create_variable(program, op, runtime));
 		break;
 
 	case H_CALL_SUMBOIL:
-		continue_or_return_if_error(execute_variable(instr, runtime));
+		continue_or_return_if_error(execute_variable(program, op, runtime));
 		break;
 
 	case H_REAL:
-		continue_or_return_if_error(execute_real(instr, runtime));
+		continue_or_return_if_error(execute_real(program, op, runtime));
 		break;
 
 	case H_IMAG:
-		continue_or_return_if_error(execute_imag(instr, runtime));
+		continue_or_return_if_error(execute_imag(program, op, runtime));
 		break;
 
 	case H_POW:
-		continue_or_return_if_error(execute_pow(instr, runtime));
+		continue_or_return_if_error(execute_pow(program, op, runtime));
+		break;
+
+	case H_CONST_CONST:
+	case H_COPY_MUL:
+	case H_CONST_RANGE:
+	case H_CONST_POW:
+	case H_CONST_ADD:
+	case H_CONST_SUB:
+	case H_CONST_MUL:
+	case H_CONST_DIV:
+		continue_or_return_if_error(execute_fused(program, op, runtime));
+		break;
+
+	case H_NUMBER_OP:
+		continue_or_return_if_error(execute_number_op(program, op, runtime));
+		break;
+
+	case H_ADD_INTEGERS:
+	case H_SUB_INTEGERS:
+	case H_MUL_INTEGERS:
+	case H_DIV_INTEGERS:
+	case H_EQUALS_INTEGERS:
+	case H_MORE_INTEGERS:
+	case H_LESS_INTEGERS:
+	case H_ADD_REALS:
+	case H_SUB_REALS:
+	case H_MUL_REALS:
+	case H_DIV_REALS:
+	case H_EQUALS_REALS:
+	case H_MORE_REALS:
+	case H_LESS_REALS:
+		continue_or_return_if_error(execute_quickened(program, op, runtime));
+		break;
+
+	case H_CALL_FUNCTION:
+		continue_or_return_if_error(execute_call_function(program, op, runtime));
 		break;
 
 	default:
-		return (struct h_error) {
-			.type   = H_ERROR_UNDEFINED_VM_INSTRUCTION,
-			.source = instr->source,
-		};
+		return (struct h_error) { .type = H_ERROR_UNDEFINED_VM_INSTRUCTION };
+	}
+
+	return_ok();
+}
+#endif
+
+#ifdef H_THREADED_DISPATCH
+static bool execute_number_fast(enum h_instr_type type, const struct h_value* value0,
+		const struct h_value* value1, struct h_value* result_value)
+{
+	enum h_number_kind kind0 = h_value_get_number_kind(value0);
+	enum h_number_kind kind1 = h_value_get_number_kind(value1);
+
+	if (h_value_get_type(value0) != H_NUMBER || h_value_get_type(value1) != H_NUMBER || kind0 != kind1)
+		return false;
+
+	if (kind0 == H_NUMBER_INTEGER) {
+		int64_t integer0 = h_value_get_integer(value0);
+		int64_t integer1 = h_value_get_integer(value1);
+		int64_t result;
+
+		switch (type) {
+		case H_ADD: result = integer0 + integer1; break;
+		case H_SUB: result = integer0 - integer1; break;
+		case H_MUL:
+			if (__builtin_mul_overflow(integer0, integer1, &result) || result == 0)
+				return false;
+
+			break;
+
+		default:
+			if (integer1 == 0 || integer0 == 0 || integer0 % integer1 != 0)
+				return false;
+
+			result = integer0 / integer1;
+			break;
+		}
+
+		if (result < -H_MAX_EXACT_INTEGER || result > H_MAX_EXACT_INTEGER)
+			return false;
+
+		*result_value = h_make_integer(result);
+
+		return true;
+	}
+
+	if (kind0 == H_NUMBER_REAL) {
+		double real0 = h_value_get_real(value0);
+		double real1 = h_value_get_real(value1);
+
+		switch (type) {
+		case H_ADD: *result_value = h_make_real(real0 + real1); break;
+		case H_SUB: *result_value = h_make_real(real0 - real1); break;
+		case H_MUL: *result_value = h_make_real(real0 * real1); break;
+		default:
+			if (real1 == 0)
+				return false;
+
+			*result_value = h_make_real(real0 / real1);
+			break;
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+static struct h_error execute_code(const struct h_program* program, const struct h_op* op,
+		const struct h_op* end, struct h_runtime* runtime)
+{
+	static const void* const handlers[array_lenght(executors)] = {
+		[H_VALUE]             = &&do_undefined,
+		[H_CONST]             = &&do_const,
+		[H_ADD]               = &&do_number,
+		[H_SUB]               = &&do_number,
+		[H_MUL]               = &&do_number,
+		[H_DIV]               = &&do_number,
+		[H_POW]               = &&do_call,
+		[H_REAL]              = &&do_call,
+		[H_IMAG]              = &&do_call,
+		[H_IMAGINARITY_CONST] = &&do_call,
+		[H_POP]               = &&do_call,
+		[H_FLIP]              = &&do_call,
+		[H_COPY]              = &&do_call,
+		[H_ARRAY_DEF]         = &&do_array_def,
+		[H_FUNCTION_DEF]      = &&do_function_def,
+		[H_ARR_PUSH]          = &&do_call,
+		[H_ARR_GET]           = &&do_call,
+		[H_ARR_POP]           = &&do_call,
+		[H_ARR_FLIP]          = &&do_call,
+		[H_ARR_COPY]          = &&do_call,
+		[H_ARR_CAT]           = &&do_call,
+		[H_ARR_TAKE]          = &&do_call,
+		[H_ARR_DROP]          = &&do_call,
+		[H_ARR_STEP]          = &&do_call,
+		[H_EQUALS]            = &&do_call,
+		[H_NOT_EQUALS]        = &&do_call,
+		[H_MORE]              = &&do_call,
+		[H_LESS]              = &&do_call,
+		[H_MORE_OR_EQUALS]    = &&do_call,
+		[H_LESS_OR_EQUALS]    = &&do_call,
+		[H_AND]               = &&do_call,
+		[H_OR]                = &&do_call,
+		[H_NOT]               = &&do_call,
+		[H_REDUCE]            = &&do_call,
+		[H_ENUMERATE]         = &&do_call,
+		[H_RANGE]             = &&do_call,
+		[H_LOAD_LIBRARY]      = &&do_undefined,
+		[H_LOAD_VARIABLE]     = &&do_undefined,
+		[H_CREATE_VARIABLE]   = &&do_call,
+		[H_CALL_SUMBOIL]      = &&do_call,
+		[H_CONST_CONST]       = &&do_const_const,
+		[H_COPY_MUL]          = &&do_copy_number,
+		[H_CONST_RANGE]       = &&do_call,
+		[H_CONST_POW]         = &&do_call,
+		[H_CONST_ADD]         = &&do_const_number,
+		[H_CONST_SUB]         = &&do_const_number,
+		[H_CONST_MUL]         = &&do_const_number,
+		[H_CONST_DIV]         = &&do_const_number,
+		[H_NUMBER_OP]         = &&do_number_op,
+		[H_ADD_INTEGERS]      = &&do_quickened,
+		[H_SUB_INTEGERS]      = &&do_quickened,
+		[H_MUL_INTEGERS]      = &&do_quickened,
+		[H_DIV_INTEGERS]      = &&do_quickened,
+		[H_EQUALS_INTEGERS]   = &&do_quickened,
+		[H_MORE_INTEGERS]     = &&do_quickened,
+		[H_LESS_INTEGERS]     = &&do_quickened,
+		[H_ADD_REALS]         = &&do_quickened,
+		[H_SUB_REALS]         = &&do_quickened,
+		[H_MUL_REALS]         = &&do_quickened,
+		[H_DIV_REALS]         = &&do_quickened,
+		[H_EQUALS_REALS]      = &&do_quickened,
+		[H_MORE_REALS]        = &&do_quickened,
+		[H_LESS_REALS]        = &&do_quickened,
+		[H_CALL_FUNCTION]     = &&do_call,
+	};
+
+	struct h_value_stack* stack = &runtime->value_stack;
+	enum h_instr_type type;
+	struct h_error error;
+
+#ifdef H_PROFILE_OPS
+	enum h_instr_type previous = H_VALUE;
+#define profile() profile_op(&previous, type)
+#else
+#define profile()
+#endif
+
+#define dispatch() \
+	if (op == end) \
+		return_ok(); \
+	type = h_op_type(op); \
+	if ((unsigned) type >= array_lenght(handlers)) \
+		goto do_undefined; \
+	profile(); \
+	goto *handlers[type]
+
+	dispatch();
+
+do_const:
+	h_value_retain(&program->constants.value[op->operand]);
+	h_value_stack_push(&runtime->value_stack, &program->constants.value[op->operand]);
+
+	op++;
+	dispatch();
+
+do_array_def:
+	error = execute_array_def(program, op, runtime);
+
+	if (error.type != H_OK)
+		return locate_error(program, op, error);
+
+	op += op->operand + 1;
+	dispatch();
+
+do_function_def:
+	error = execute_function_def(program, op, runtime);
+
+	if (error.type != H_OK)
+		return locate_error(program, op, error);
+
+	op += op->operand + 1;
+	dispatch();
+
+do_const_const:
+	h_value_retain(&program->constants.value[op->operand]);
+	h_value_stack_push(stack, &program->constants.value[op->operand]);
+
+	h_value_retain(&program->constants.value[op->operand + 1]);
+	h_value_stack_push(stack, &program->constants.value[op->operand + 1]);
+
+	op++;
+	dispatch();
+
+do_number:
+	if (runtime->quickening && !(h_op_flags(op) & H_OP_DEOPTIMIZED))
+		quicken(program, op, stack);
+
+	if ((!(h_op_flags(op) & H_OP_VERIFIED) && stack->count < 2) || !execute_number_fast(type, &stack->value[stack->count - 1],
+				&stack->value[stack->count - 2], &stack->value[stack->count - 2]))
+		goto do_call;
+
+	stack->count--;
+
+	op++;
+	dispatch();
+
+do_number_op:
+	if (op->operand > H_DIV || !execute_number_fast(op->operand, &stack->value[stack->count - 1],
+				&stack->value[stack->count - 2], &stack->value[stack->count - 2]))
+		goto do_call;
+
+	stack->count--;
+
+	op++;
+	dispatch();
+
+do_const_number:
+	if (stack->count < 1 || !execute_number_fast(h_fusions[type].second,
+				&program->constants.value[op->operand], &stack->value[stack->count - 1],
+				&stack->value[stack->count - 1]))
+		goto do_call;
+
+	op++;
+	dispatch();
+
+do_copy_number:
+	if (stack->count < 1 || !execute_number_fast(h_fusions[type].second, &stack->value[stack->count - 1],
+				&stack->value[stack->count - 1], &stack->value[stack->count - 1]))
+		goto do_call;
+
+	op++;
+	dispatch();
+
+do_call:
+	if (runtime->quickening && is_quickenable(type) && !(h_op_flags(op) & H_OP_DEOPTIMIZED))
+		quicken(program, op, stack);
+
+	error = executors[type](program, op, runtime);
+
+	if (error.type != H_OK)
+		return locate_error(program, op, error);
+
+	op++;
+	dispatch();
+
+do_quickened:
+	if (execute_specialized(op, type, stack)) {
+		op++;
+		dispatch();
+	}
+
+	type = h_op_generic(type);
+	goto do_call;
+
+do_undefined:
+	return locate_error(program, op, (struct h_error) { .type = H_ERROR_UNDEFINED_VM_INSTRUCTION });
+
+#undef dispatch
+#undef profile
+}
+#else
+static struct h_error execute_code(const struct h_program* program, const struct h_op* op,
+		const struct h_op* end, struct h_runtime* runtime)
+{
+#ifdef H_PROFILE_OPS
+	enum h_instr_type previous = H_VALUE;
+#endif
+
+	for (; op < end; op++) {
+		enum h_instr_type type = h_op_type(op);
+
+#ifdef H_PROFILE_OPS
+		if ((unsigned) type < H_INSTR_TYPE_COUNT)
+			profile_op(&previous, type);
+#endif
+
+		if (runtime->quickening && is_quickenable(type) && !(h_op_flags(op) & H_OP_DEOPTIMIZED))
+			quicken(program, op, &runtime->value_stack);
+
+		struct h_error error = execute_instr(program, op, runtime);
+
+		if (error.type != H_OK)
+			return locate_error(program, op, error);
+
+		if (type == H_ARRAY_DEF || type == H_FUNCTION_DEF)
+			op += op->operand;
 	}
 
 	return_ok();
 }
+#endif
+
+struct h_error h_execute_program(const struct h_program* program, struct h_runtime* runtime)
+{
+	h_value_stack_reserve(&runtime->value_stack, program->height);
+
+	return execute_code(program, program->code.ops, program->code.ops + program->code.count, runtime);
+}
+
+struct h_error h_execute_function(const struct h_function* function, struct h_runtime* runtime)
+{
+	h_value_stack_reserve(&runtime->value_stack, h_function_code(function)[-1].height);
+
+	return execute_code(function->program, h_function_code(function),
+			h_function_code(function) + function->count, runtime);
+}
 
-static struct h_error execute_value(const struct h_instr* instr, struct h_runtime* runtime)
+struct h_error h_execute_instr_stack(const struct h_instr_stack* instr_stack, struct h_runtime* runtime)
 {
-	h_value_stack_push(&runtime->value_stack, &instr->value.value);
+	struct h_program* program = h_compile(instr_stack);
+	struct h_error error      = h_execute_program(program, runtime);
+
+	h_program_release(program);
+
+	return error;
+}
+
+static struct h_error execute_const(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
+{
+	h_value_retain(&program->constants.value[op->operand]);
+	h_value_stack_push(&runtime->value_stack, &program->constants.value[op->operand]);
 
 	return_ok();
 }
 
-static struct h_error execute_add(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_add(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result value1 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result value1 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
 	continue_or_return_if_pop_error(value1);
 
-	continue_or_return_if_type_error(value0.value, H_NUMBER, instr->source);
-	continue_or_return_if_type_error(value1.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(value0.value, H_NUMBER);
+	continue_or_return_if_type_error(value1.value, H_NUMBER);
 
-	struct h_value result_value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = value0.value.value.number + value1.value.value.number,
-	};
+	struct h_value result_value = h_number_add(&value0.value, &value1.value);
+
+	h_value_release(&value0.value);
+	h_value_release(&value1.value);
 
 	h_value_stack_push(&runtime->value_stack, &result_value);
 
 	return_ok();
 }
 
-static struct h_error execute_sub(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_sub(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result value1 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result value1 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
 	continue_or_return_if_pop_error(value1);
 
-	continue_or_return_if_type_error(value0.value, H_NUMBER, instr->source);
-	continue_or_return_if_type_error(value1.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(value0.value, H_NUMBER);
+	continue_or_return_if_type_error(value1.value, H_NUMBER);
 
-	struct h_value result_value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = value0.value.value.number - value1.value.value.number,
-	};
+	struct h_value result_value = h_number_sub(&value0.value, &value1.value);
+
+	h_value_release(&value0.value);
+	h_value_release(&value1.value);
 
 	h_value_stack_push(&runtime->value_stack, &result_value);
 
 	return_ok();
 }
 
-static struct h_error execute_mul(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_mul(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result value1 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result value1 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
 	continue_or_return_if_pop_error(value1);
 
-	continue_or_return_if_type_error(value0.value, H_NUMBER, instr->source);
-	continue_or_return_if_type_error(value1.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(value0.value, H_NUMBER);
+	continue_or_return_if_type_error(value1.value, H_NUMBER);
 
-	struct h_value result_value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = value0.value.value.number * value1.value.value.number,
-	};
+	struct h_value result_value = h_number_mul(&value0.value, &value1.value);
+
+	h_value_release(&value0.value);
+	h_value_release(&value1.value);
 
 	h_value_stack_push(&runtime->value_stack, &result_value);
 
 	return_ok();
 }
 
-static struct h_error execute_div(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_div(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result value1 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result value1 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
 	continue_or_return_if_pop_error(value1);
 
-	continue_or_return_if_type_error(value0.value, H_NUMBER, instr->source);
-	continue_or_return_if_type_error(value1.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(value0.value, H_NUMBER);
+	continue_or_return_if_type_error(value1.value, H_NUMBER);
 
-	if (value1.value.value.number == 0)
-		return (struct h_error) {
-			.type   = H_ERROR_DIVISON_BY_ZERO,
-			.source = instr->source,
-		};
+	if (!h_number_is_true(&value1.value))
+		return (struct h_error) { .type = H_ERROR_DIVISON_BY_ZERO };
 
-	struct h_value result_value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = value0.value.value.number / value1.value.value.number,
-	};
+	struct h_value result_value = h_number_div(&value0.value, &value1.value);
+
+	h_value_release(&value0.value);
+	h_value_release(&value1.value);
 
 	h_value_stack_push(&runtime->value_stack, &result_value);
 
 	return_ok();
 }
 
-static struct h_error execute_array_def(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_array_def(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
 	struct h_runtime array_runtime = { .sumboil_stack = runtime->sumboil_stack,
-		{ .root_stack = &runtime->value_stack } };
+		{ .root_stack = &runtime->value_stack, .arena = runtime->arena }, .arena = runtime->arena,
+		.register_vm = runtime->register_vm, .optimization_level = runtime->optimization_level,
+		.quickening = runtime->quickening, .jit = runtime->jit };
 
-	continue_or_return_if_error(h_execute_instr_stack(&instr->value.array_def, &array_runtime));
+	h_value_stack_reserve(&array_runtime.value_stack, op->height);
 
-	struct h_value value = (struct h_value) {
-		.type        = H_ARRAY,
-		.value.array = array_runtime.value_stack,
-	};
+	struct h_error error = execute_code(program, op + 1, op + 1 + op->operand, &array_runtime);
+	runtime->sumboil_stack = array_runtime.sumboil_stack;
+
+	continue_or_return_if_error(error);
+
+	struct h_value value = h_make_array(h_array_from_values(runtime->arena, &array_runtime.value_stack));
 	
 	h_value_stack_push(&runtime->value_stack, &value);
 
 	return_ok();
 }
 
-static struct h_error execute_imaginarity_const(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_function_def(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = I,
-	};
+	struct h_function* function = h_function_create(runtime->arena, (struct h_program*) program,
+			op - program->code.ops + 1, op->operand);
+
+	struct h_value value = h_make_function(function);
 
 	h_value_stack_push(&runtime->value_stack, &value);
 
 	return_ok();
 }
 
-static struct h_error execute_pop(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_imaginarity_const(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value value = h_make_number(I);
+
+	h_value_stack_push(&runtime->value_stack, &value);
+
+	return_ok();
+}
+
+static struct h_error execute_pop(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
+{
+	struct h_value_stack_pop_result value = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value);
 
@@ -358,10 +1218,11 @@ static struct h_error execute_pop(const struct h_instr* instr, struct h_runtime*
 	return_ok();
 }
 
-static struct h_error execute_flip(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_flip(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result value1 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result value1 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
 	continue_or_return_if_pop_error(value1);
@@ -372,333 +1233,555 @@ static struct h_error execute_flip(const struct h_instr* instr, struct h_runtime
 	return_ok();
 }
 
-static struct h_error execute_copy(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_copy(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value);
 
+	h_value_retain(&value.value);
+
 	h_value_stack_push(&runtime->value_stack, &value.value);
 	h_value_stack_push(&runtime->value_stack, &value.value);
 
 	return_ok();
 }
 
-static struct h_error execute_arr_get(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_arr_get(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value);
-	continue_or_return_if_type_error(value.value, H_ARRAY, instr->source);
+	continue_or_return_if_type_error(value.value, H_ARRAY);
+	continue_or_return_if_too_short(h_value_get_array(&value.value), 1);
 
-	struct h_value_stack_pop_result array_value = h_value_stack_pop(&value.value.value.array,
-			&instr->source);
-
-	continue_or_return_if_pop_error(array_value);
+	struct h_value array_value = h_array_pop(h_array_mutable(&value.value));
 
 	h_value_stack_push(&runtime->value_stack, &value.value);
-	h_value_stack_push(&runtime->value_stack, &array_value.value);
+	h_value_stack_push(&runtime->value_stack, &array_value);
 	
 	return_ok();
 }
 
-static struct h_error execute_arr_push(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_arr_push(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result value1 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result value1 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
 	continue_or_return_if_pop_error(value1);
 
-	continue_or_return_if_type_error(value1.value, H_ARRAY, instr->source);
+	continue_or_return_if_type_error(value1.value, H_ARRAY);
 
-	h_value_stack_push(&value1.value.value.array, &value0.value);
+	h_array_push(h_array_mutable(&value1.value), value0.value);
 	h_value_stack_push(&runtime->value_stack, &value1.value);
 
 	return_ok();
 }
 
-static struct h_error execute_arr_pop(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_arr_pop(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value);
-	continue_or_return_if_type_error(value.value, H_ARRAY, instr->source);
-
-	struct h_value_stack_pop_result array_value = h_value_stack_pop(&value.value.value.array,
-			&instr->source);
+	continue_or_return_if_type_error(value.value, H_ARRAY);
+	continue_or_return_if_too_short(h_value_get_array(&value.value), 1);
 
-	continue_or_return_if_pop_error(array_value);
+	struct h_value array_value = h_array_pop(h_array_mutable(&value.value));
 
-	h_value_stack_free_value(&array_value.value);
+	h_value_stack_free_value(&array_value);
 
 	h_value_stack_push(&runtime->value_stack, &value.value);
 
 	return_ok();
 }
 
-static struct h_error execute_arr_flip(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_arr_flip(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result array = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result array = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(array);
-	continue_or_return_if_type_error(array.value, H_ARRAY, instr->source);
+	continue_or_return_if_type_error(array.value, H_ARRAY);
+	continue_or_return_if_too_short(h_value_get_array(&array.value), 2);
 
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&array.value.value.array, &instr->source);
-	struct h_value_stack_pop_result value1 = h_value_stack_pop(&array.value.value.array, &instr->source);
+	struct h_array* values = h_array_mutable(&array.value);
 
-	continue_or_return_if_pop_error(value0);
-	continue_or_return_if_pop_error(value1);
+	struct h_value value0 = h_array_pop(values);
+	struct h_value value1 = h_array_pop(values);
 
-	h_value_stack_push(&array.value.value.array, &value0.value);
-	h_value_stack_push(&array.value.value.array, &value1.value);
+	h_array_push(values, value0);
+	h_array_push(values, value1);
 
 	h_value_stack_push(&runtime->value_stack, &array.value);
 
 	return_ok();
 }
 
-static struct h_error execute_arr_copy(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_arr_copy(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result array = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result array = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(array);
-	continue_or_return_if_type_error(array.value, H_ARRAY, instr->source);
+	continue_or_return_if_type_error(array.value, H_ARRAY);
+	continue_or_return_if_too_short(h_value_get_array(&array.value), 1);
 
-	struct h_value_stack_pop_result value = h_value_stack_pop(&array.value.value.array, &instr->source);
+	struct h_array* values = h_array_mutable(&array.value);
 
-	continue_or_return_if_pop_error(value);
+	struct h_value value = h_array_get(values, h_array_count(values) - 1);
+	h_value_retain(&value);
 
-	h_value_stack_push(&array.value.value.array, &value.value);
-	h_value_stack_push(&array.value.value.array, &value.value);
+	h_array_push(values, value);
 
 	h_value_stack_push(&runtime->value_stack, &array.value);
 
 	return_ok();
 }
 
-static struct h_error execute_equals(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_equals(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result value1 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result value1 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
 	continue_or_return_if_pop_error(value1);
 
-	continue_or_return_if_type_error(value0.value, H_NUMBER, instr->source);
-	continue_or_return_if_type_error(value1.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(value0.value, H_NUMBER);
+	continue_or_return_if_type_error(value1.value, H_NUMBER);
 
-	struct h_value result_value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = value0.value.value.number == value1.value.value.number,
-	};
+	struct h_value result_value = h_make_integer(h_number_equals(&value0.value, &value1.value));
+
+	h_value_release(&value0.value);
+	h_value_release(&value1.value);
 
 	h_value_stack_push(&runtime->value_stack, &result_value);
 
 	return_ok();
 }
 
-static struct h_error execute_not_equals(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_not_equals(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result value1 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result value1 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
 	continue_or_return_if_pop_error(value1);
 
-	continue_or_return_if_type_error(value0.value, H_NUMBER, instr->source);
-	continue_or_return_if_type_error(value1.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(value0.value, H_NUMBER);
+	continue_or_return_if_type_error(value1.value, H_NUMBER);
 
-	struct h_value result_value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = value0.value.value.number != value1.value.value.number,
-	};
+	struct h_value result_value = h_make_integer(!h_number_equals(&value0.value, &value1.value));
+
+	h_value_release(&value0.value);
+	h_value_release(&value1.value);
 
 	h_value_stack_push(&runtime->value_stack, &result_value);
 
 	return_ok();
 }
 
-static struct h_error execute_more(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_more(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result value1 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result value1 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
 	continue_or_return_if_pop_error(value1);
 
-	continue_or_return_if_type_error(value0.value, H_NUMBER, instr->source);
-	continue_or_return_if_type_error(value1.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(value0.value, H_NUMBER);
+	continue_or_return_if_type_error(value1.value, H_NUMBER);
 
-	struct h_value result_value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = creal(value0.value.value.number) > creal(value1.value.value.number),
-	};
+	int order = h_number_compare(&value0.value, &value1.value);
+
+	struct h_value result_value = h_make_integer(order == 1);
+
+	h_value_release(&value0.value);
+	h_value_release(&value1.value);
 
 	h_value_stack_push(&runtime->value_stack, &result_value);
 
 	return_ok();
 }
 
-static struct h_error execute_less(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_less(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result value1 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result value1 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
 	continue_or_return_if_pop_error(value1);
 
-	continue_or_return_if_type_error(value0.value, H_NUMBER, instr->source);
-	continue_or_return_if_type_error(value1.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(value0.value, H_NUMBER);
+	continue_or_return_if_type_error(value1.value, H_NUMBER);
 
-	struct h_value result_value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = creal(value0.value.value.number) < creal(value1.value.value.number),
-	};
+	int order = h_number_compare(&value0.value, &value1.value);
+
+	struct h_value result_value = h_make_integer(order == -1);
+
+	h_value_release(&value0.value);
+	h_value_release(&value1.value);
 
 	h_value_stack_push(&runtime->value_stack, &result_value);
 
 	return_ok();
 }
 
-static struct h_error execute_more_or_equals(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_more_or_equals(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result value1 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result value1 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
 	continue_or_return_if_pop_error(value1);
 
-	continue_or_return_if_type_error(value0.value, H_NUMBER, instr->source);
-	continue_or_return_if_type_error(value1.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(value0.value, H_NUMBER);
+	continue_or_return_if_type_error(value1.value, H_NUMBER);
 
-	struct h_value result_value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = creal(value0.value.value.number) >= creal(value1.value.value.number),
-	};
+	int order = h_number_compare(&value0.value, &value1.value);
+
+	struct h_value result_value = h_make_integer(order == 0 || order == 1);
+
+	h_value_release(&value0.value);
+	h_value_release(&value1.value);
 
 	h_value_stack_push(&runtime->value_stack, &result_value);
 
 	return_ok();
 }
 
-static struct h_error execute_less_or_equals(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_less_or_equals(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result value1 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result value1 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
 	continue_or_return_if_pop_error(value1);
 
-	continue_or_return_if_type_error(value0.value, H_NUMBER, instr->source);
-	continue_or_return_if_type_error(value1.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(value0.value, H_NUMBER);
+	continue_or_return_if_type_error(value1.value, H_NUMBER);
 
-	struct h_value result_value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = creal(value0.value.value.number) <= creal(value1.value.value.number),
-	};
+	int order = h_number_compare(&value0.value, &value1.value);
+
+	struct h_value result_value = h_make_integer(order == 0 || order == -1);
+
+	h_value_release(&value0.value);
+	h_value_release(&value1.value);
 
 	h_value_stack_push(&runtime->value_stack, &result_value);
 
 	return_ok();
 }
 
-static struct h_error execute_and(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_and(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result value1 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result value1 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
 	continue_or_return_if_pop_error(value1);
 
-	continue_or_return_if_type_error(value0.value, H_NUMBER, instr->source);
-	continue_or_return_if_type_error(value1.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(value0.value, H_NUMBER);
+	continue_or_return_if_type_error(value1.value, H_NUMBER);
 
-	struct h_value result_value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = value0.value.value.number && value1.value.value.number,
-	};
+	struct h_value result_value = h_make_integer(h_number_is_true(&value0.value)
+			&& h_number_is_true(&value1.value));
+
+	h_value_release(&value0.value);
+	h_value_release(&value1.value);
 
 	h_value_stack_push(&runtime->value_stack, &result_value);
 
 	return_ok();
 }
 
-static struct h_error execute_or(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_or(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result value1 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result value1 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
 	continue_or_return_if_pop_error(value1);
 
-	continue_or_return_if_type_error(value0.value, H_NUMBER, instr->source);
-	continue_or_return_if_type_error(value1.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(value0.value, H_NUMBER);
+	continue_or_return_if_type_error(value1.value, H_NUMBER);
 
-	struct h_value result_value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = value0.value.value.number || value1.value.value.number,
-	};
+	struct h_value result_value = h_make_integer(h_number_is_true(&value0.value)
+			|| h_number_is_true(&value1.value));
+
+	h_value_release(&value0.value);
+	h_value_release(&value1.value);
 
 	h_value_stack_push(&runtime->value_stack, &result_value);
 
 	return_ok();
 }
 
-static struct h_error execute_not(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_not(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
-	continue_or_return_if_type_error(value0.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(value0.value, H_NUMBER);
 
-	struct h_value result_value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = !value0.value.value.number,
-	};
+	struct h_value result_value = h_make_integer(!h_number_is_true(&value0.value));
+
+	h_value_release(&value0.value);
 
 	h_value_stack_push(&runtime->value_stack, &result_value);
 
 	return_ok();
 }
 
-static struct h_error execute_reduce(const struct h_instr* instr, struct h_runtime* runtime)
+static bool is_packed_kernel_op(enum h_instr_type type)
+{
+	return type == H_ADD || type == H_SUB || type == H_MUL || type == H_DIV;
+}
+
+static struct h_value apply_number_op(enum h_instr_type type, const struct h_value* value0,
+		const struct h_value* value1)
+{
+	switch (type) {
+	case H_ADD: return h_number_add(value0, value1);
+	case H_SUB: return h_number_sub(value0, value1);
+	case H_MUL: return h_number_mul(value0, value1);
+	default: return h_number_div(value0, value1);
+	}
+}
+
+static struct h_value multiply_integers(const int64_t* integers, size_t from, size_t to, size_t stride)
+{
+	if (to - from == 1)
+		return h_make_integer(integers[from * stride]);
+
+	struct h_value low  = multiply_integers(integers, from, from + (to - from) / 2, stride);
+	struct h_value high = multiply_integers(integers, from + (to - from) / 2, to, stride);
+	struct h_value result = h_number_mul(&high, &low);
+
+	h_value_release(&low);
+	h_value_release(&high);
+
+	return result;
+}
+
+static struct h_error reduce_integers(const struct h_op* op, const int64_t* integers, size_t count,
+		size_t stride, struct h_value* result)
+{
+	bool has_zero = false;
+	for (size_t i = 0; i < count && op->type == H_MUL; i++)
+		has_zero |= integers[i * stride] == 0;
+
+	if (op->type == H_MUL && !has_zero) {
+		*result = multiply_integers(integers, 0, count, stride);
+
+		return_ok();
+	}
+
+	struct h_value acc = h_make_integer(integers[0]);
+
+	for (size_t i = 1; i < count; i++) {
+		struct h_value element = h_make_integer(integers[i * stride]);
+
+		if (op->type == H_DIV && !h_number_is_true(&acc)) {
+			h_value_release(&acc);
+
+			return (struct h_error) { .type = H_ERROR_DIVISON_BY_ZERO };
+		}
+
+		struct h_value next = apply_number_op(op->type, &element, &acc);
+
+		h_value_release(&acc);
+		acc = next;
+	}
+
+	*result = acc;
+
+	return_ok();
+}
+
+static struct h_error reduce_packed(const struct h_op* op, const struct h_array* array, struct h_value* result)
+{
+	enum h_array_kind kind;
+	size_t stride;
+	const void* data = h_array_data(array, &kind, &stride);
+
+	size_t count = h_array_count(array) * stride;
+
+	if (kind == H_ARRAY_INTEGERS)
+		return reduce_integers(op, data, h_array_count(array), stride, result);
+
+	if (kind == H_ARRAY_REALS) {
+		const double* reals = data;
+		double acc = reals[0];
+
+		for (size_t i = stride; i < count; i += stride) {
+			switch (op->type) {
+			case H_ADD: acc = reals[i] + acc; break;
+			case H_SUB: acc = reals[i] - acc; break;
+			case H_MUL: acc = reals[i] * acc; break;
+			default:
+				if (acc == 0)
+					return (struct h_error) { .type = H_ERROR_DIVISON_BY_ZERO };
+
+				acc = reals[i] / acc;
+				break;
+			}
+		}
+
+		*result = h_make_number(acc);
+
+		return_ok();
+	}
+
+	const double complex* complexes = data;
+	double complex acc = complexes[0];
+
+	for (size_t i = stride; i < count; i += stride) {
+		switch (op->type) {
+		case H_ADD: acc = complexes[i] + acc; break;
+		case H_SUB: acc = complexes[i] - acc; break;
+		case H_MUL: acc = complexes[i] * acc; break;
+		default:
+			if (acc == 0)
+				return (struct h_error) { .type = H_ERROR_DIVISON_BY_ZERO };
+
+			acc = complexes[i] / acc;
+			break;
+		}
+	}
+
+	*result = h_make_number(acc);
+
+	return_ok();
+}
+
+static bool translate_body(const struct h_function* body, size_t arguments, size_t iterations,
+		struct h_runtime* runtime, struct h_register_code* code)
+{
+	if (!runtime->register_vm || !h_translate_registers(body, arguments, code))
+		return false;
+
+	h_optimize_registers(code, runtime->optimization_level);
+
+	if (!h_prepare_registers(code, runtime))
+		return false;
+
+	if (runtime->jit)
+		code->native = h_jit_lookup(body, code, iterations);
+
+	return true;
+}
+
+static struct h_error reduce_registers(struct h_register_code* code, const struct h_array* values,
+		struct h_value* save_value)
+{
+	for (size_t i = 1; i < h_array_count(values); i++) {
+		struct h_value arguments[2] = { *save_value, h_array_get(values, i) };
+		struct h_value result;
+
+		continue_or_return_if_error(h_execute_registers(code, arguments, &result));
+
+		h_value_release(save_value);
+		*save_value = result;
+	}
+
+	return_ok();
+}
+
+static struct h_error execute_reduce(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result function = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result array    = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result function = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result array    = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(array);
 	continue_or_return_if_pop_error(function);
 
-	continue_or_return_if_type_error(array.value, H_ARRAY, instr->source);
-	continue_or_return_if_type_error(function.value, H_FUNCTION, instr->source);
+	continue_or_return_if_type_error(array.value, H_ARRAY);
+	continue_or_return_if_type_error(function.value, H_FUNCTION);
 
-	if (array.value.value.array.count < 2)
-		return (struct h_error) {
-			.type   = H_ERROR_APPLYING_REDUCE_TO_ONE_VALUE_ARRAY,
-			.source = instr->source,
-		};
+	const struct h_array* values     = h_value_get_array(&array.value);
+	const struct h_function* body = h_value_get_function(&function.value);
+
+	if (h_array_count(values) < 2)
+		return (struct h_error) { .type = H_ERROR_APPLYING_REDUCE_TO_ONE_VALUE_ARRAY };
+
+	struct h_value save_value;
+	enum h_array_kind kind;
+	size_t stride;
+
+	if (h_array_data(values, &kind, &stride) != NULL && (kind == H_ARRAY_INTEGERS || kind == H_ARRAY_REALS
+				|| kind == H_ARRAY_COMPLEXES) && body->count == 1
+			&& is_packed_kernel_op(h_op_generic(h_op_type(&h_function_code(body)[0])))) {
+		struct h_op kernel = { .type = h_op_generic(h_op_type(&h_function_code(body)[0])) };
+
+		continue_or_return_if_error(reduce_packed(&kernel, values, &save_value));
+
+		h_value_stack_free_value(&function.value);
+		h_value_stack_free_value(&array.value);
+
+		h_value_stack_push(&runtime->value_stack, &save_value);
+
+		return_ok();
+	}
 
-	struct h_value save_value = array.value.value.array.value[0];
+	save_value = h_array_get(values, 0);
+	h_value_retain(&save_value);
 
-	for (int i = 1; i < array.value.value.array.count; i++) {
+	struct h_register_code code;
+
+	if (translate_body(body, 2, h_array_count(values) - 1, runtime, &code)) {
+		struct h_error error = reduce_registers(&code, values, &save_value);
+		h_release_registers(&code);
+
+		continue_or_return_if_error(error);
+
+		h_value_stack_free_value(&function.value);
+		h_value_stack_free_value(&array.value);
+
+		h_value_stack_push(&runtime->value_stack, &save_value);
+
+		return_ok();
+	}
+
+	for (int i = 1; i < h_array_count(values); i++) {
 		struct h_runtime function_runtime = {
 			.value_stack = (struct h_value_stack) {
 				.root_stack = &runtime->value_stack,
 			},
-			.sumboil_stack = runtime->sumboil_stack,
+			.sumboil_stack      = runtime->sumboil_stack,
+			.arena              = runtime->arena,
+			.register_vm        = runtime->register_vm,
+			.optimization_level = runtime->optimization_level,
+			.quickening         = runtime->quickening,
+			.jit                = runtime->jit,
 		};
 
-		struct h_value* value = &array.value.value.array.value[i];
+		struct h_value value = h_array_get(values, i);
+		h_value_retain(&value);
 
 		h_value_stack_push(&function_runtime.value_stack, &save_value);
-		h_value_stack_push(&function_runtime.value_stack, value);
+		h_value_stack_push(&function_runtime.value_stack, &value);
 
-		continue_or_return_if_error(h_execute_instr_stack(&function.value.value.function,
-					&function_runtime));
+		struct h_error error = h_execute_function(body, &function_runtime);
+		runtime->sumboil_stack = function_runtime.sumboil_stack;
 
-		struct h_value_stack_pop_result result_value = h_value_stack_pop(
-			&function_runtime.value_stack, &instr->source);
+		continue_or_return_if_error(error);
+
+		struct h_value_stack_pop_result result_value = h_value_stack_pop(&function_runtime.value_stack);
 
 		continue_or_return_if_pop_error(result_value);
 
@@ -715,38 +1798,175 @@ static struct h_error execute_reduce(const struct h_instr* instr, struct h_runti
 	return_ok();
 }
 
-static struct h_error execute_enumerate(const struct h_instr* instr, struct h_runtime* runtime)
+struct packed_map {
+	enum h_instr_type type;
+	const struct h_value* constant;
+};
+
+static bool is_packed_map(const struct h_array* array, const struct h_function* body, struct packed_map* map)
+{
+	if (array->kind != H_ARRAY_INTEGERS && array->kind != H_ARRAY_REALS && array->kind != H_ARRAY_COMPLEXES)
+		return false;
+
+	const struct h_op* code = h_function_code(body);
+	enum h_instr_type first = h_op_type(&code[0]);
+
+	if (body->count == 1 && (unsigned) first < H_INSTR_TYPE_COUNT && h_fusions[first].first == H_CONST)
+		map->type = h_fusions[first].second;
+	else if (body->count == 2 && first == H_CONST)
+		map->type = h_op_generic(h_op_type(&code[1]));
+	else
+		return false;
+
+	map->constant = &body->program->constants.value[code[0].operand];
+
+	if (!is_packed_kernel_op(map->type) || h_value_get_type(map->constant) != H_NUMBER)
+		return false;
+
+	return array->kind != H_ARRAY_REALS || cimag(h_value_get_number(map->constant)) == 0;
+}
+
+static struct h_error enumerate_packed(const struct packed_map* map, struct h_array* array)
+{
+	double complex constant = h_value_get_number(map->constant);
+
+	if (array->kind == H_ARRAY_INTEGERS) {
+		for (size_t i = 0; i < h_array_count(array); i++) {
+			struct h_value element = h_array_get(array, i);
+
+			if (map->type == H_DIV && !h_number_is_true(&element))
+				return (struct h_error) { .type = H_ERROR_DIVISON_BY_ZERO };
+
+			h_array_set(array, i, apply_number_op(map->type, map->constant, &element));
+		}
+
+		return_ok();
+	}
+
+	if (array->kind == H_ARRAY_REALS) {
+		double* reals = array->data.reals.reals;
+		double real   = creal(constant);
+
+		for (size_t i = 0; i < array->data.reals.count; i++) {
+			switch (map->type) {
+			case H_ADD: reals[i] = real + reals[i]; break;
+			case H_SUB: reals[i] = real - reals[i]; break;
+			case H_MUL: reals[i] = real * reals[i]; break;
+			default:
+				if (reals[i] == 0)
+					return (struct h_error) { .type = H_ERROR_DIVISON_BY_ZERO };
+
+				reals[i] = real / reals[i];
+				break;
+			}
+		}
+
+		return_ok();
+	}
+
+	double complex* complexes = array->data.complexes.complexes;
+
+	for (size_t i = 0; i < array->data.complexes.count; i++) {
+		switch (map->type) {
+		case H_ADD: complexes[i] = constant + complexes[i]; break;
+		case H_SUB: complexes[i] = constant - complexes[i]; break;
+		case H_MUL: complexes[i] = constant * complexes[i]; break;
+		default:
+			if (complexes[i] == 0)
+				return (struct h_error) { .type = H_ERROR_DIVISON_BY_ZERO };
+
+			complexes[i] = constant / complexes[i];
+			break;
+		}
+	}
+
+	return_ok();
+}
+
+static struct h_error enumerate_registers(struct h_register_code* code, struct h_array* values)
+{
+	for (size_t i = 0; i < h_array_count(values); i++) {
+		struct h_value argument = h_array_get(values, i);
+		struct h_value result;
+
+		continue_or_return_if_error(h_execute_registers(code, &argument, &result));
+
+		h_array_set(values, i, result);
+	}
+
+	return_ok();
+}
+
+static struct h_error execute_enumerate(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result function = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result array    = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result function = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result array    = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(array);
 	continue_or_return_if_pop_error(function);
 
-	continue_or_return_if_type_error(array.value, H_ARRAY, instr->source);
-	continue_or_return_if_type_error(function.value, H_FUNCTION, instr->source);
+	continue_or_return_if_type_error(array.value, H_ARRAY);
+	continue_or_return_if_type_error(function.value, H_FUNCTION);
+
+	struct h_array* values           = h_array_mutable(&array.value);
+	const struct h_function* body = h_value_get_function(&function.value);
+
+	struct packed_map map;
+
+	if (is_packed_map(values, body, &map)) {
+		continue_or_return_if_error(enumerate_packed(&map, values));
+
+		h_value_stack_free_value(&function.value);
+
+		h_value_stack_push(&runtime->value_stack, &array.value);
+
+		return_ok();
+	}
+
+	struct h_register_code code;
+
+	if (translate_body(body, 1, h_array_count(values), runtime, &code)) {
+		struct h_error error = enumerate_registers(&code, values);
+		h_release_registers(&code);
 
-	for (int i = 0; i < array.value.value.array.count; i++) {
+		continue_or_return_if_error(error);
+
+		h_value_stack_free_value(&function.value);
+
+		h_value_stack_push(&runtime->value_stack, &array.value);
+
+		return_ok();
+	}
+
+	for (int i = 0; i < h_array_count(values); i++) {
 		struct h_runtime function_runtime = {
 			.value_stack = (struct h_value_stack) {
 				.root_stack = &runtime->value_stack,
 			},
-			.sumboil_stack = runtime->sumboil_stack,
+			.sumboil_stack      = runtime->sumboil_stack,
+			.arena              = runtime->arena,
+			.register_vm        = runtime->register_vm,
+			.optimization_level = runtime->optimization_level,
+			.quickening         = runtime->quickening,
+			.jit                = runtime->jit,
 		};
 
-		struct h_value* value = &array.value.value.array.value[i];
+		struct h_value value = h_array_get(values, i);
+		h_value_retain(&value);
 
-		h_value_stack_push(&function_runtime.value_stack, value);
+		h_value_stack_push(&function_runtime.value_stack, &value);
 
-		continue_or_return_if_error(h_execute_instr_stack(&function.value.value.function,
-					&function_runtime));
+		struct h_error error = h_execute_function(body, &function_runtime);
+		runtime->sumboil_stack = function_runtime.sumboil_stack;
 
-		struct h_value_stack_pop_result result_value = h_value_stack_pop(
-			&function_runtime.value_stack, &instr->source);
+		continue_or_return_if_error(error);
+
+		struct h_value_stack_pop_result result_value = h_value_stack_pop(&function_runtime.value_stack);
 
 		continue_or_return_if_pop_error(result_value);
 
-		array.value.value.array.value[i] = result_value.value;
+		h_array_set(values, i, result_value.value);
 
 		h_value_stack_free(&function_runtime.value_stack);
 	}
@@ -758,158 +1978,299 @@ static struct h_error execute_enumerate(const struct h_instr* instr, struct h_ru
 	return_ok();
 }
 
-static struct h_error execute_range(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_range(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result from = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result to   = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result from = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result to   = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(from);
 	continue_or_return_if_pop_error(to);
 
-	continue_or_return_if_type_error(from.value, H_NUMBER, instr->source);
-	continue_or_return_if_type_error(to.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(from.value, H_NUMBER);
+	continue_or_return_if_type_error(to.value, H_NUMBER);
 
-	struct h_value_stack array = {0};
+	struct h_array* array = h_array_create_packed(runtime->arena, H_ARRAY_INTEGERS);
 
-	for (int i = from.value.value.number; i < creal(to.value.value.number); i++) {
-		struct h_value value = (struct h_value) {
-			.type         = H_NUMBER,
-			.value.number = i,
-		};
+	int start = h_value_get_number(&from.value);
+	if (creal(h_value_get_number(&to.value)) > start)
+		h_array_reserve(array, ceil(creal(h_value_get_number(&to.value)) - start));
 
-		h_value_stack_push(&array, &value);
-	}
+	for (int i = start; i < creal(h_value_get_number(&to.value)); i++)
+		array->data.integers.integers[array->data.integers.count++] = i;
 
-	struct h_value result = (struct h_value) {
-		.type        = H_ARRAY,
-		.value.array = array,
-	};
+	h_value_release(&from.value);
+	h_value_release(&to.value);
+
+	struct h_value result = h_make_array(array);
 
 	h_value_stack_push(&runtime->value_stack, &result);
 
 	return_ok();
 }
 
-static struct h_error execute_create_variable(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_create_variable(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value);
 
-	struct h_sumboil sumboil = (struct h_sumboil) { .value = value.value };
-	snprintf(sumboil.name, sizeof(sumboil.name), "%s", instr->value.sumboil);
-
-	h_sumboil_stack_push(&runtime->sumboil_stack, &sumboil);
+	h_sumboil_stack_set(&runtime->sumboil_stack, program->slots[op->operand], value.value);
 
 	return_ok();
 }
 
-static struct h_error execute_variable(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error lookup_variable(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime, struct h_value** value)
 {
-	struct h_value* value = NULL;
-	for (int i = 0; i < runtime->sumboil_stack.count; i++) {
-		if (strcmp(runtime->sumboil_stack.sumboils[i].name, instr->value.sumboil) == 0) {
-			value = &runtime->sumboil_stack.sumboils[i].value;
-			break;
-		}
-	}
+	struct h_sumboil_stack* stack = &runtime->sumboil_stack;
+	uint32_t slot                 = program->slots[op->operand];
+
+	if (op->operand >= stack->cache_count)
+		h_sumboil_stack_reserve_caches(stack, program->symbols.count);
 
-	if (value == NULL)
-		return (struct h_error) {
-			.type   = H_ERROR_SUMBOIL_NOT_FOUND,
-			.source = instr->source,
+	struct h_sumboil_cache* cache = &stack->caches[op->operand];
+
+	if (slot < stack->count && cache->sumboils == stack->sumboils && cache->sumboil == &stack->sumboils[slot]
+			&& cache->sumboil->version == cache->version) {
+		*value = &cache->sumboil->value;
+		stack->cache_hits++;
+	} else {
+		*value = h_sumboil_stack_get(stack, slot);
+		stack->cache_misses++;
+
+		if (*value == NULL)
+			return (struct h_error) { .type = H_ERROR_SUMBOIL_NOT_FOUND };
+
+		*cache = (struct h_sumboil_cache) {
+			.sumboils = stack->sumboils,
+			.sumboil  = &stack->sumboils[slot],
+			.version  = stack->sumboils[slot].version,
 		};
+	}
 
-	if (value->type == H_FUNCTION) {
-		continue_or_return_if_error(h_execute_instr_stack(&value->value.function, runtime));
-		return_ok();
+	return_ok();
+}
+
+static struct h_error call_function(const struct h_value* value, struct h_runtime* runtime)
+{
+	struct h_value function = *value;
+	h_value_retain(&function);
+
+	struct h_error error = h_execute_function(h_value_get_function(&function), runtime);
+
+	h_value_release(&function);
+
+	return error;
+}
+
+static struct h_error execute_variable(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
+{
+	struct h_value* value;
+
+	continue_or_return_if_error(lookup_variable(program, op, runtime, &value));
+
+	if (h_value_get_type(value) == H_FUNCTION) {
+		if (runtime->quickening && !(h_op_flags(op) & H_OP_DEOPTIMIZED))
+			rewrite_op(program, op, H_CALL_FUNCTION);
+
+		return call_function(value, runtime);
 	}
 
+	h_value_retain(value);
+	h_value_stack_push(&runtime->value_stack, value);
+
+	return_ok();
+}
+
+static struct h_error execute_call_function(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
+{
+	struct h_value* value;
+
+	continue_or_return_if_error(lookup_variable(program, op, runtime, &value));
+
+	if (h_value_get_type(value) == H_FUNCTION)
+		return call_function(value, runtime);
+
+	deoptimize(op, H_CALL_FUNCTION);
+
+	h_value_retain(value);
 	h_value_stack_push(&runtime->value_stack, value);
 
 	return_ok();
 }
 
-static struct h_error execute_real(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_real(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
-	continue_or_return_if_type_error(value0.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(value0.value, H_NUMBER);
 
-	struct h_value result_value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = creal(value0.value.value.number),
-	};
+	if (h_value_get_number_kind(&value0.value) != H_NUMBER_COMPLEX) {
+		h_value_stack_push(&runtime->value_stack, &value0.value);
+
+		return_ok();
+	}
+
+	struct h_value result_value = h_make_real(creal(h_value_get_number(&value0.value)));
 
 	h_value_stack_push(&runtime->value_stack, &result_value);
 
 	return_ok();
 }
 
-static struct h_error execute_imag(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_imag(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
-	continue_or_return_if_type_error(value0.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(value0.value, H_NUMBER);
 
-	struct h_value result_value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = cimag(value0.value.value.number),
-	};
+	struct h_value result_value = h_value_get_number_kind(&value0.value) == H_NUMBER_INTEGER
+			|| h_value_get_number_kind(&value0.value) == H_NUMBER_BIG
+		? h_make_integer(0) : h_make_real(cimag(h_value_get_number(&value0.value)));
+
+	h_value_release(&value0.value);
 
 	h_value_stack_push(&runtime->value_stack, &result_value);
 
 	return_ok();
 }
 
-static struct h_error execute_pow(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_pow(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result value0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result value1 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result value0 = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result value1 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(value0);
 	continue_or_return_if_pop_error(value1);
 
-	continue_or_return_if_type_error(value0.value, H_NUMBER, instr->source);
-	continue_or_return_if_type_error(value1.value, H_NUMBER, instr->source);
+	continue_or_return_if_type_error(value0.value, H_NUMBER);
+	continue_or_return_if_type_error(value1.value, H_NUMBER);
 
-	struct h_value result_value = (struct h_value) {
-		.type         = H_NUMBER,
-		.value.number = cpow(value1.value.value.number, value0.value.value.number),
-	};
+	struct h_value result_value = h_number_pow(&value1.value, &value0.value);
+
+	h_value_release(&value0.value);
+	h_value_release(&value1.value);
 
 	h_value_stack_push(&runtime->value_stack, &result_value);
 
 	return_ok();
 }
 
-static struct h_error execute_arr_cat(const struct h_instr* instr, struct h_runtime* runtime)
+static struct h_error execute_arr_cat(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
 {
-	struct h_value_stack_pop_result array1 = h_value_stack_pop(&runtime->value_stack, &instr->source);
-	struct h_value_stack_pop_result array0 = h_value_stack_pop(&runtime->value_stack, &instr->source);
+	struct h_value_stack_pop_result array1 = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result array0 = pop_operand(op, &runtime->value_stack);
 
 	continue_or_return_if_pop_error(array0);
 	continue_or_return_if_pop_error(array1);
 
-	continue_or_return_if_type_error(array0.value, H_ARRAY, instr->source);
-	continue_or_return_if_type_error(array1.value, H_ARRAY, instr->source);
+	continue_or_return_if_type_error(array0.value, H_ARRAY);
+	continue_or_return_if_type_error(array1.value, H_ARRAY);
 
-	struct h_value_stack result_array = {0};
+	h_array_append(h_array_mutable(&array0.value), h_value_get_array(&array1.value));
 
-	for (int i = 0; i < array0.value.value.array.count; i++)
-		h_value_stack_push(&result_array, &array0.value.value.array.value[i]);
+	h_value_release(&array1.value);
 
-	for (int i = 0; i < array1.value.value.array.count; i++)
-		h_value_stack_push(&result_array, &array1.value.value.array.value[i]);
+	h_value_stack_push(&runtime->value_stack, &array0.value);
 
-	struct h_value value = (struct h_value) {
-		.type        = H_ARRAY,
-		.value.array = result_array,
-	};
+	return_ok();
+}
 
-	h_value_stack_push(&runtime->value_stack, &value);
+static size_t clamp_count(const struct h_value* number, size_t count)
+{
+	double real = creal(h_value_get_number(number));
+
+	if (real <= 0)
+		return 0;
+
+	return real < count ? (size_t) real : count;
+}
+
+static struct h_error execute_arr_take(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
+{
+	struct h_value_stack_pop_result count = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result array = pop_operand(op, &runtime->value_stack);
+
+	continue_or_return_if_pop_error(count);
+	continue_or_return_if_pop_error(array);
+
+	continue_or_return_if_type_error(count.value, H_NUMBER);
+	continue_or_return_if_type_error(array.value, H_ARRAY);
+
+	struct h_array* values = h_value_get_array(&array.value);
+	struct h_value result  = h_make_array(h_array_create_view(runtime->arena, values, 0,
+				clamp_count(&count.value, h_array_count(values)), 1));
+
+	h_value_release(&array.value);
+
+	h_value_stack_push(&runtime->value_stack, &result);
+
+	return_ok();
+}
+
+static struct h_error execute_arr_drop(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
+{
+	struct h_value_stack_pop_result count = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result array = pop_operand(op, &runtime->value_stack);
+
+	continue_or_return_if_pop_error(count);
+	continue_or_return_if_pop_error(array);
+
+	continue_or_return_if_type_error(count.value, H_NUMBER);
+	continue_or_return_if_type_error(array.value, H_ARRAY);
+
+	struct h_array* values = h_value_get_array(&array.value);
+	size_t dropped         = clamp_count(&count.value, h_array_count(values));
+
+	struct h_value result = h_make_array(h_array_create_view(runtime->arena, values, dropped,
+				h_array_count(values) - dropped, 1));
+
+	h_value_release(&array.value);
+
+	h_value_stack_push(&runtime->value_stack, &result);
+
+	return_ok();
+}
+
+static struct h_error execute_arr_step(const struct h_program* program, const struct h_op* op,
+		struct h_runtime* runtime)
+{
+	struct h_value_stack_pop_result step  = pop_operand(op, &runtime->value_stack);
+	struct h_value_stack_pop_result array = pop_operand(op, &runtime->value_stack);
+
+	continue_or_return_if_pop_error(step);
+	continue_or_return_if_pop_error(array);
+
+	continue_or_return_if_type_error(step.value, H_NUMBER);
+	continue_or_return_if_type_error(array.value, H_ARRAY);
+
+	double real = creal(h_value_get_number(&step.value));
+
+	if (!isfinite(real) || real < 1 || real >= (double) SIZE_MAX)
+		return (struct h_error) { .type = H_ERROR_INVALID_ARRAY_STEP };
+
+	struct h_array* values = h_value_get_array(&array.value);
+	size_t count           = h_array_count(values);
+	size_t stride          = real;
+
+	struct h_value result = h_make_array(h_array_create_view(runtime->arena, values, 0,
+				count == 0 ? 0 : (count - 1) / stride + 1, stride));
+
+	h_value_release(&array.value);
+
+	h_value_stack_push(&runtime->value_stack, &result);
 
 	return_ok();
 }